@@ -0,0 +1,71 @@
+#!/bin/bash
+
+###################################################################################################
+# Check if gzip is installed (brotli is optional)
+if ! command -v gzip &> /dev/null; then
+    echo "gzip is not installed. Please install it and try again."
+    exit 1
+fi
+
+if ! command -v brotli &> /dev/null; then
+    echo "brotli is not installed, only .gz files will be created."
+fi
+
+# Web assets of the server and their location on SPIFFS
+ASSETS_DIR=./server/www
+TARGET_DIR=./server/data/www
+
+if [ ! -d "$ASSETS_DIR" ]; then
+    echo "No web assets found in $ASSETS_DIR."
+    exit 1
+fi
+
+###################################################################################################
+# Copy the assets
+
+echo "Copying web assets to $TARGET_DIR..."
+
+# Start from scratch, so no outdated compressed files are left behind
+rm -rf "$TARGET_DIR"
+mkdir -p "$TARGET_DIR"
+cp -R "$ASSETS_DIR"/. "$TARGET_DIR"/
+
+###################################################################################################
+# Create the compressed files
+#
+# The server sends file.br or file.gz instead of file to clients that accept the encoding, so
+# the ESP32 never has to compress anything itself. Already compressed formats (images, fonts)
+# are skipped, and compressed files that are not smaller than the original are removed.
+
+echo "Compressing web assets..."
+
+find "$TARGET_DIR" -type f \( -name "*.html" -o -name "*.htm" -o -name "*.css" -o -name "*.js" \
+    -o -name "*.mjs" -o -name "*.json" -o -name "*.map" -o -name "*.svg" -o -name "*.txt" \
+    -o -name "*.csv" -o -name "*.xml" -o -name "*.ico" -o -name "*.wasm" \) | while read -r file; do
+    size=$(wc -c < "$file")
+
+    gzip -9 -n -c "$file" > "$file.gz"
+    if [ "$(wc -c < "$file.gz")" -ge "$size" ]; then
+        rm -f "$file.gz"
+    fi
+
+    if command -v brotli &> /dev/null; then
+        brotli -q 11 -c "$file" > "$file.br"
+        if [ "$(wc -c < "$file.br")" -ge "$size" ]; then
+            rm -f "$file.br"
+        fi
+    fi
+
+    # SPIFFS supports paths of up to 31 characters
+    name="/www${file#$TARGET_DIR}.br"
+    if [ ${#name} -gt 31 ]; then
+        echo "Warning: $name is too long for SPIFFS."
+    fi
+done
+
+echo "Compressing web assets complete."
+
+###################################################################################################
+# Done
+
+echo "Done."
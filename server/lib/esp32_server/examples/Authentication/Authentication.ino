@@ -113,13 +113,17 @@ void setup() {
   // The path is ignored for the default node.
   secureServer.setDefaultNode(node404);
 
-  // Add the middleware. These functions will be called globally for every request
-  // Note: The functions are called in the order they are added to the server.
-  // This means, we need to add the authentication middleware first, because the
-  // authorization middleware needs the headers that will be set by the authentication
-  // middleware (First we check the identity, then we see what the user is allowed to do)
+  // Add the middleware. The authentication middleware will be called globally for every
+  // request, so the internal headers can never be set by the client.
+  // The authorization middleware is only added for the route group below /internal, so
+  // it is called for /internal and /internal/admin, but not for any other page. This also
+  // applies to the 404 node if an unknown page below /internal is requested.
+  // Note: Global middleware is always called before the middleware of a route group.
+  // This is required here, because the authorization middleware needs the headers that
+  // will be set by the authentication middleware (First we check the identity, then we
+  // see what the user is allowed to do)
   secureServer.addMiddleware(&middlewareAuthentication);
-  secureServer.addMiddleware(&middlewareAuthorization);
+  secureServer.addMiddleware("/internal", &middlewareAuthorization);
 
   Serial.println("Starting server...");
   secureServer.start();
@@ -216,15 +220,17 @@ void middlewareAuthentication(HTTPRequest * req, HTTPResponse * res, std::functi
  * username/password combination and stores it in the request, this function makes use of this information
  * to allow or deny access.
  *
- * This example only prevents unauthorized access to every ResourceNode stored under an /internal/... path.
+ * This example only prevents unauthorized access to every ResourceNode stored under an /internal/... path,
+ * as the function is only added to that route group.
  */
 void middlewareAuthorization(HTTPRequest * req, HTTPResponse * res, std::function<void()> next) {
   // Get the username (if any)
   std::string username = req->getHeader(HEADER_USERNAME);
 
-  // Check that only logged-in users may get to the internal area (All URLs starting with /internal)
+  // Check that only logged-in users may get to the internal area. We do not need to check the
+  // URL here, as the server only calls this function for nodes in the /internal group.
   // Only a simple example, more complicated configuration is up to you.
-  if (username == "" && req->getRequestString().substr(0,9) == "/internal") {
+  if (username == "") {
     // Same as the deny-part in middlewareAuthentication()
     res->setStatusCode(401);
     res->setStatusText("Unauthorized");
@@ -72,18 +72,16 @@ void setup() {
   ResourceNode * nodeRoot = new ResourceNode("/", "GET", &handleRoot);
   ResourceNode * node404  = new ResourceNode("", "GET", &handle404);
 
-  // Register the echo handler. You can use the same handler function for multiple
-  // nodes. Note also that we now have three resource nodes for the / URL, so
+  // Register the echo handler. A single node can handle several methods, which are
+  // combined with "|". Note also that we now have two resource nodes for the / URL, so
   // the server uses only the method to distinguish between them.
-  ResourceNode * nodeEchoPut  = new ResourceNode("/", "PUT", &handleEcho);
-  ResourceNode * nodeEchoPost = new ResourceNode("/", "POST", &handleEcho);
+  ResourceNode * nodeEcho = new ResourceNode("/", METHOD_PUT | METHOD_POST, &handleEcho);
 
   // Add the root node to the server
   secureServer.registerNode(nodeRoot);
 
-  // Add the nodes for the echo service
-  secureServer.registerNode(nodeEchoPut);
-  secureServer.registerNode(nodeEchoPost);
+  // Add the node for the echo service
+  secureServer.registerNode(nodeEcho);
 
   // Add the 404 not found node to the server.
   // The path is ignored for the default node.
@@ -175,6 +175,10 @@ void setup() {
 
   // Add the handler nodes that deal with modifying the events:
   ResourceNode * getEventsNode = new ResourceNode("/api/events", "GET", &handleGetEvents);
+  // The list only changes when events are added, deleted or fired, so clients that poll it get
+  // the same response for up to 10 seconds without creating the JSON again. Each change clears
+  // the cache, so it never returns an outdated list.
+  getEventsNode->setHandlerCacheTTL(10000);
   secureServer->registerNode(getEventsNode);
   ResourceNode * postEventNode = new ResourceNode("/api/events", "POST", &handlePostEvent);
   secureServer->registerNode(postEventNode);
@@ -204,6 +208,7 @@ void loop() {
 
       // Deactivate the event so it doesn't fire again
       events[i].active = false;
+      secureServer->clearHandlerCache();
       }
     }
   }
@@ -475,6 +480,7 @@ void handlePostEvent(HTTPRequest * req, HTTPResponse * res) {
       events[i].time = eTime;
       events[i].state = eState;
       events[i].active = true;
+      secureServer->clearHandlerCache();
     }
   }
 
@@ -516,6 +522,7 @@ void handleDeleteEvent(HTTPRequest * req, HTTPResponse * res) {
   if (eid < MAX_EVENTS) {
     // Set the inactive flag
     events[eid].active = false;
+    secureServer->clearHandlerCache();
     // And return a successful response without body
     res->setStatusCode(204);
     res->setStatusText("No Content");
@@ -0,0 +1,635 @@
+/**
+ * Load driver for the benchmark server, see README.md
+ *
+ * Every connection is driven by its own thread, which sends a request, waits for the complete
+ * response and measures the time in between. With keep-alive, the connection is reused for all
+ * requests of the thread. Without keep-alive, each request opens a new connection, so the
+ * measured latency includes the TCP (and TLS) handshake.
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Must match the key in bench_server.cpp
+const char * SECRET_KEY = "c2VjcmV0LWtleS1vZi10aGUtYmVuY2htYXJrLXNlcnZlcg==";
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int httpPort = 8080;
+  int httpsPort = 8081;
+  int connections = 4;
+  double duration = 5.0;
+  size_t largeSize = 65536;
+  size_t wsMessageSize = 64;
+  std::vector<std::string> scenarios;
+  std::vector<std::string> protocols;
+  std::vector<std::string> modes;
+  std::string label;
+  std::string output;
+};
+
+const char * ALL_SCENARIOS[] = {"get", "post-small", "post-large", "get-large", "get-large-http10", "websocket", "404",
+  "static", "static-304", "static-gzip", "status", "status-cached"};
+
+/**
+ * A client connection, either plain TCP or TLS
+ */
+class Connection {
+public:
+  Connection(SSL_CTX * sslCtx): _sslCtx(sslCtx), _fd(-1), _ssl(NULL) {}
+  ~Connection() {
+    close();
+  }
+
+  bool open(const sockaddr_in &addr) {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) {
+      return false;
+    }
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    // The server may drop connections without responding if all slots are busy
+    timeval tv = {10, 0};
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(_fd, (const sockaddr *)&addr, sizeof(addr)) != 0) {
+      close();
+      return false;
+    }
+    if (_sslCtx != NULL) {
+      _ssl = SSL_new(_sslCtx);
+      SSL_set_fd(_ssl, _fd);
+      if (SSL_connect(_ssl) != 1) {
+        close();
+        return false;
+      }
+    }
+    _pending.clear();
+    return true;
+  }
+
+  void close() {
+    if (_ssl != NULL) {
+      SSL_shutdown(_ssl);
+      SSL_free(_ssl);
+      _ssl = NULL;
+    }
+    if (_fd >= 0) {
+      ::close(_fd);
+      _fd = -1;
+    }
+  }
+
+  bool isOpen() {
+    return _fd >= 0;
+  }
+
+  bool sendAll(const char * data, size_t length) {
+    while (length > 0) {
+      int sent = _ssl != NULL ? SSL_write(_ssl, data, (int)length) : (int)send(_fd, data, length, MSG_NOSIGNAL);
+      if (sent <= 0) {
+        return false;
+      }
+      data += sent;
+      length -= sent;
+    }
+    return true;
+  }
+
+  /** Reads more data into the pending buffer. Returns false on EOF or error */
+  bool fill() {
+    char buffer[16384];
+    int received = _ssl != NULL ? SSL_read(_ssl, buffer, sizeof(buffer)) : (int)recv(_fd, buffer, sizeof(buffer), 0);
+    if (received <= 0) {
+      return false;
+    }
+    _pending.append(buffer, received);
+    return true;
+  }
+
+  /** Reads until the pending buffer contains the given string, returns its position */
+  size_t readUntil(const char * delimiter) {
+    size_t searchStart = 0;
+    while (true) {
+      size_t pos = _pending.find(delimiter, searchStart);
+      if (pos != std::string::npos) {
+        return pos;
+      }
+      searchStart = _pending.size() > 4 ? _pending.size() - 4 : 0;
+      if (!fill()) {
+        return std::string::npos;
+      }
+    }
+  }
+
+  /** Removes length bytes from the pending buffer after making sure that they have been received */
+  bool consume(size_t length) {
+    while (_pending.size() < length) {
+      if (!fill()) {
+        return false;
+      }
+    }
+    _pending.erase(0, length);
+    return true;
+  }
+
+  std::string &pending() {
+    return _pending;
+  }
+
+private:
+  SSL_CTX * _sslCtx;
+  int _fd;
+  SSL * _ssl;
+  std::string _pending;
+};
+
+bool headerValueContains(const std::string &head, const char * name, const char * token) {
+  std::string lowerHead = head;
+  std::transform(lowerHead.begin(), lowerHead.end(), lowerHead.begin(), ::tolower);
+  size_t pos = lowerHead.find(std::string("\r\n") + name + ":");
+  if (pos == std::string::npos) {
+    return false;
+  }
+  size_t end = lowerHead.find("\r\n", pos + 2);
+  return lowerHead.substr(pos, end - pos).find(token) != std::string::npos;
+}
+
+/**
+ * Reads a complete response. Returns the status code, or -1 on error. connectionClosed is set if
+ * the server closes the connection after the response. If allowChunked is false, a chunked
+ * response is an error (HTTP/1.0 clients do not support it).
+ */
+int readResponse(Connection &con, bool &connectionClosed, bool allowChunked = true) {
+  size_t headEnd = con.readUntil("\r\n\r\n");
+  if (headEnd == std::string::npos) {
+    return -1;
+  }
+  std::string head = con.pending().substr(0, headEnd + 2);
+  con.pending().erase(0, headEnd + 4);
+  if (head.compare(0, 9, "HTTP/1.1 ") != 0 || head.size() < 12) {
+    return -1;
+  }
+  int status = atoi(head.c_str() + 9);
+  connectionClosed = !headerValueContains(head, "connection", "keep-alive");
+
+  std::string lowerHead = head;
+  std::transform(lowerHead.begin(), lowerHead.end(), lowerHead.begin(), ::tolower);
+  size_t lengthPos = lowerHead.find("\r\ncontent-length:");
+  if (headerValueContains(head, "transfer-encoding", "chunked")) {
+    if (!allowChunked) {
+      return -1;
+    }
+    while (true) {
+      size_t lineEnd = con.readUntil("\r\n");
+      if (lineEnd == std::string::npos) {
+        return -1;
+      }
+      size_t chunkSize = strtoul(con.pending().c_str(), NULL, 16);
+      if (!con.consume(lineEnd + 2 + chunkSize + 2)) {
+        return -1;
+      }
+      if (chunkSize == 0) {
+        break;
+      }
+    }
+  } else if (lengthPos != std::string::npos) {
+    if (!con.consume(strtoul(head.c_str() + lengthPos + 17, NULL, 10))) {
+      return -1;
+    }
+  } else if (status != 101 && status != 204 && status != 304) {
+    // The body ends with the connection
+    while (con.fill());
+    con.pending().clear();
+    connectionClosed = true;
+  }
+  return status;
+}
+
+std::string buildRequest(const std::string &method, const std::string &path, const std::string &body, bool keepAlive,
+    const std::string &headers = "", const char * version = "HTTP/1.1") {
+  std::string request = method + " " + path + " " + version + "\r\nHost: localhost\r\n" + headers;
+  request += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+  if (method == "POST") {
+    request += "Content-Type: text/plain\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+  }
+  request += "\r\n";
+  return request + body;
+}
+
+/** Sends a websocket frame with the masked payload and waits for the echo */
+bool websocketEcho(Connection &con, const std::string &message) {
+  std::string frame;
+  frame += (char)0x81;
+  if (message.size() < 126) {
+    frame += (char)(0x80 | message.size());
+  } else {
+    frame += (char)(0x80 | 126);
+    frame += (char)(message.size() >> 8);
+    frame += (char)(message.size() & 0xff);
+  }
+  const char mask[4] = {0x12, 0x34, 0x56, 0x78};
+  frame.append(mask, 4);
+  for (size_t i = 0; i < message.size(); i++) {
+    frame += (char)(message[i] ^ mask[i % 4]);
+  }
+  if (!con.sendAll(frame.data(), frame.size())) {
+    return false;
+  }
+
+  while (con.pending().size() < 2) {
+    if (!con.fill()) {
+      return false;
+    }
+  }
+  size_t payloadLength = (uint8_t)con.pending()[1] & 0x7f;
+  size_t headerLength = 2;
+  if (payloadLength == 126) {
+    while (con.pending().size() < 4) {
+      if (!con.fill()) {
+        return false;
+      }
+    }
+    payloadLength = ((uint8_t)con.pending()[2] << 8) | (uint8_t)con.pending()[3];
+    headerLength = 4;
+  }
+  return con.consume(headerLength + payloadLength) && payloadLength == message.size();
+}
+
+bool websocketHandshake(Connection &con) {
+  std::string request =
+    "GET /echo HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  bool closed;
+  return con.sendAll(request.data(), request.size()) && readResponse(con, closed) == 101;
+}
+
+void websocketClose(Connection &con) {
+  const char frame[] = {(char)0x88, (char)0x80, 0x12, 0x34, 0x56, 0x78};
+  con.sendAll(frame, sizeof(frame));
+  con.close();
+}
+
+struct WorkerResult {
+  std::vector<uint32_t> latenciesUs;
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  uint64_t handshakes = 0;
+  uint64_t unexpectedStatus = 0;
+};
+
+struct Run {
+  std::string scenario;
+  bool https;
+  bool keepAlive;
+};
+
+void runWorker(const Options &opts, const Run &run, SSL_CTX * sslCtx, const sockaddr_in &addr,
+    Clock::time_point deadline, WorkerResult &result) {
+  Connection con(run.https ? sslCtx : NULL);
+  bool websocket = run.scenario == "websocket";
+  std::string message(opts.wsMessageSize, 'x');
+
+  std::string request;
+  int expectedStatus = 200;
+  bool allowChunked = true;
+  if (run.scenario == "get") {
+    request = buildRequest("GET", "/", "", run.keepAlive);
+  } else if (run.scenario == "post-small") {
+    request = buildRequest("POST", "/secret", SECRET_KEY, run.keepAlive);
+  } else if (run.scenario == "post-large") {
+    request = buildRequest("POST", "/upload", std::string(opts.largeSize, 'a'), run.keepAlive);
+  } else if (run.scenario == "get-large") {
+    request = buildRequest("GET", "/large?size=" + std::to_string(opts.largeSize), "", run.keepAlive);
+  } else if (run.scenario == "get-large-http10") {
+    request = buildRequest("GET", "/large?size=" + std::to_string(opts.largeSize), "", run.keepAlive, "", "HTTP/1.0");
+    allowChunked = false;
+  } else if (run.scenario == "404") {
+    request = buildRequest("GET", "/does/not/exist", "", run.keepAlive);
+    expectedStatus = 404;
+  } else if (run.scenario == "static") {
+    request = buildRequest("GET", "/static/file.bin", "", run.keepAlive);
+  } else if (run.scenario == "static-304") {
+    request = buildRequest("GET", "/static/file.bin", "", run.keepAlive, "If-None-Match: *\r\n");
+    expectedStatus = 304;
+  } else if (run.scenario == "status") {
+    request = buildRequest("GET", "/status", "", run.keepAlive);
+  } else if (run.scenario == "status-cached") {
+    request = buildRequest("GET", "/status-cached", "", run.keepAlive);
+  } else if (run.scenario == "static-gzip") {
+    request = buildRequest("GET", "/static/file.bin", "", run.keepAlive, "Accept-Encoding: gzip, deflate, br\r\n");
+  }
+
+  while (Clock::now() < deadline) {
+    Clock::time_point start = Clock::now();
+    bool ok = true;
+    if (!con.isOpen()) {
+      ok = con.open(addr) && (!websocket || websocketHandshake(con));
+      if (ok) {
+        result.handshakes++;
+      }
+    }
+    if (ok && websocket) {
+      ok = websocketEcho(con, message);
+    } else if (ok) {
+      bool closed = false;
+      int status = -1;
+      ok = con.sendAll(request.data(), request.size()) && (status = readResponse(con, closed, allowChunked)) > 0;
+      if (ok && status != expectedStatus) {
+        result.unexpectedStatus++;
+      }
+      if (closed) {
+        con.close();
+      }
+    }
+    uint32_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+    if (ok) {
+      result.requests++;
+      result.latenciesUs.push_back(latency);
+      if (!run.keepAlive) {
+        if (websocket) {
+          websocketClose(con);
+        } else {
+          con.close();
+        }
+      }
+    } else {
+      result.errors++;
+      con.close();
+    }
+  }
+  if (websocket && con.isOpen()) {
+    websocketClose(con);
+  }
+}
+
+/** Requests a /_bench/ resource over plain HTTP and extracts a field from the JSON */
+long long queryServer(const sockaddr_in &addr, const char * path, const char * field) {
+  Connection con(NULL);
+  if (!con.open(addr)) {
+    return -1;
+  }
+  std::string request = buildRequest("GET", path, "", false);
+  con.sendAll(request.data(), request.size());
+  size_t headEnd = con.readUntil("\r\n\r\n");
+  while (con.fill());
+  if (headEnd == std::string::npos) {
+    return -1;
+  }
+  std::string key = std::string("\"") + field + "\":";
+  size_t pos = con.pending().find(key, headEnd);
+  return pos == std::string::npos ? -1 : atoll(con.pending().c_str() + pos + key.size());
+}
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+std::string jsonEscape(const std::string &value) {
+  std::string escaped;
+  for (size_t i = 0; i < value.size(); i++) {
+    if (value[i] == '"' || value[i] == '\\') {
+      escaped += '\\';
+    }
+    escaped += value[i];
+  }
+  return escaped;
+}
+
+std::string executeRun(const Options &opts, const Run &run, SSL_CTX * sslCtx) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  inet_pton(AF_INET, opts.host.c_str(), &addr.sin_addr);
+  sockaddr_in heapAddr = addr;
+  heapAddr.sin_port = htons(opts.httpPort);
+  addr.sin_port = htons(run.https ? opts.httpsPort : opts.httpPort);
+
+  queryServer(heapAddr, "/_bench/heap?reset=1", "peak_bytes");
+  const char * writesPath = run.https ? "/_bench/writes?protocol=https" : "/_bench/writes";
+  long long writesBefore = queryServer(heapAddr, writesPath, "writes");
+  long long recordsBefore = queryServer(heapAddr, writesPath, "records");
+
+  std::vector<WorkerResult> results(opts.connections);
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  Clock::time_point deadline = start + std::chrono::microseconds((long long)(opts.duration * 1e6));
+  for (int i = 0; i < opts.connections; i++) {
+    threads.push_back(std::thread(runWorker, std::cref(opts), std::cref(run), sslCtx, std::cref(addr),
+      deadline, std::ref(results[i])));
+  }
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  long long writes = queryServer(heapAddr, writesPath, "writes") - writesBefore;
+  long long records = queryServer(heapAddr, writesPath, "records") - recordsBefore;
+  long long heapPeak = queryServer(heapAddr, "/_bench/heap", "peak_bytes");
+  long long heapCurrent = queryServer(heapAddr, "/_bench/heap", "current_bytes");
+
+  WorkerResult total;
+  for (size_t i = 0; i < results.size(); i++) {
+    total.requests += results[i].requests;
+    total.errors += results[i].errors;
+    total.handshakes += results[i].handshakes;
+    total.unexpectedStatus += results[i].unexpectedStatus;
+    total.latenciesUs.insert(total.latenciesUs.end(), results[i].latenciesUs.begin(), results[i].latenciesUs.end());
+  }
+  std::sort(total.latenciesUs.begin(), total.latenciesUs.end());
+  double meanUs = 0;
+  for (size_t i = 0; i < total.latenciesUs.size(); i++) {
+    meanUs += total.latenciesUs[i];
+  }
+  if (!total.latenciesUs.empty()) {
+    meanUs /= total.latenciesUs.size();
+  }
+
+  // Writes of the server per completed request (or websocket message)
+  double writesPerRequest = total.requests > 0 ? (double)writes / total.requests : 0;
+  double recordsPerRequest = total.requests > 0 ? (double)records / total.requests : 0;
+
+  char buffer[1024];
+  snprintf(buffer, sizeof(buffer),
+    "{\"scenario\":\"%s\",\"protocol\":\"%s\",\"keep_alive\":%s,\"connections\":%d,"
+    "\"duration_s\":%.3f,\"requests\":%llu,\"errors\":%llu,\"unexpected_status\":%llu,"
+    "\"req_per_s\":%.1f,\"handshakes\":%llu,\"handshakes_per_s\":%.1f,"
+    "\"latency_us\":{\"mean\":%.1f,\"p50\":%u,\"p99\":%u,\"p999\":%u,\"max\":%u},"
+    "\"heap_peak_bytes\":%lld,\"heap_current_bytes\":%lld,"
+    "\"writes_per_request\":%.2f,\"records_per_request\":%.2f}",
+    run.scenario.c_str(), run.https ? "https" : "http", run.keepAlive ? "true" : "false", opts.connections,
+    elapsed, (unsigned long long)total.requests, (unsigned long long)total.errors,
+    (unsigned long long)total.unexpectedStatus, total.requests / elapsed,
+    (unsigned long long)total.handshakes, total.handshakes / elapsed,
+    meanUs, percentile(total.latenciesUs, 0.5), percentile(total.latenciesUs, 0.99),
+    percentile(total.latenciesUs, 0.999), total.latenciesUs.empty() ? 0 : total.latenciesUs.back(),
+    heapPeak, heapCurrent, writesPerRequest, recordsPerRequest);
+
+  fprintf(stderr, "%-10s %-5s %-10s %10.1f req/s  p50 %6u us  p99 %6u us  p999 %6u us  %8.1f hs/s  errors %llu  peak heap %lld  writes/req %.2f\n",
+    run.scenario.c_str(), run.https ? "https" : "http", run.keepAlive ? "keep-alive" : "close",
+    total.requests / elapsed, percentile(total.latenciesUs, 0.5), percentile(total.latenciesUs, 0.99),
+    percentile(total.latenciesUs, 0.999), total.handshakes / elapsed,
+    (unsigned long long)(total.errors + total.unexpectedStatus), heapPeak, writesPerRequest);
+  return buffer;
+}
+
+std::vector<std::string> splitList(const std::string &value) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= value.size()) {
+    size_t end = value.find(',', start);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    if (end > start) {
+      items.push_back(value.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return items;
+}
+
+void usage(const char * name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  --host <ip>            Address of the benchmark server (default: 127.0.0.1)\n"
+    "  --port <n>             HTTP port of the server, HTTPS uses port+1 (default: 8080)\n"
+    "  --connections <n>      Concurrent connections (default: 4)\n"
+    "  --duration <s>         Duration of each run in seconds (default: 5)\n"
+    "  --scenarios <list>     Comma-separated list of get, post-small, post-large, get-large, get-large-http10,\n"
+    "                         websocket, 404, static, static-304, static-gzip, status,\n"
+    "                         status-cached\n"
+    "                         (default: all)\n"
+    "  --protocols <list>     http, https or both (default: http,https)\n"
+    "  --modes <list>         keep-alive, close or both (default: keep-alive,close)\n"
+    "  --large-size <bytes>   Body size for post-large and get-large(-http10) (default: 65536)\n"
+    "  --ws-size <bytes>      Message size for websocket (default: 64, max: 65535)\n"
+    "  --label <text>         Label that is stored in the result, e.g. the commit\n"
+    "  --output <file>        Write the JSON result to the file instead of stdout\n",
+    name);
+}
+
+} /* namespace */
+
+int main(int argc, char ** argv) {
+  Options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    std::string value = argv[++i];
+    if (arg == "--host") {
+      opts.host = value;
+    } else if (arg == "--port") {
+      opts.httpPort = atoi(value.c_str());
+      opts.httpsPort = opts.httpPort + 1;
+    } else if (arg == "--connections") {
+      opts.connections = atoi(value.c_str());
+    } else if (arg == "--duration") {
+      opts.duration = atof(value.c_str());
+    } else if (arg == "--scenarios") {
+      opts.scenarios = splitList(value);
+    } else if (arg == "--protocols") {
+      opts.protocols = splitList(value);
+    } else if (arg == "--modes") {
+      opts.modes = splitList(value);
+    } else if (arg == "--large-size") {
+      opts.largeSize = strtoul(value.c_str(), NULL, 10);
+    } else if (arg == "--ws-size") {
+      opts.wsMessageSize = strtoul(value.c_str(), NULL, 10);
+    } else if (arg == "--label") {
+      opts.label = value;
+    } else if (arg == "--output") {
+      opts.output = value;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (opts.scenarios.empty()) {
+    opts.scenarios.assign(ALL_SCENARIOS, ALL_SCENARIOS + sizeof(ALL_SCENARIOS) / sizeof(ALL_SCENARIOS[0]));
+  }
+  if (opts.protocols.empty()) {
+    opts.protocols = splitList("http,https");
+  }
+  if (opts.modes.empty()) {
+    opts.modes = splitList("keep-alive,close");
+  }
+  if (opts.connections <= 0 || opts.duration <= 0 || opts.wsMessageSize > 65535) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  SSL_CTX * sslCtx = SSL_CTX_new(TLS_client_method());
+  // The server uses a self-signed certificate and does not support session resumption, so each
+  // new connection is a full handshake
+  SSL_CTX_set_verify(sslCtx, SSL_VERIFY_NONE, NULL);
+  SSL_CTX_set_session_cache_mode(sslCtx, SSL_SESS_CACHE_OFF);
+
+  std::vector<std::string> results;
+  for (size_t s = 0; s < opts.scenarios.size(); s++) {
+    for (size_t p = 0; p < opts.protocols.size(); p++) {
+      for (size_t m = 0; m < opts.modes.size(); m++) {
+        Run run;
+        run.scenario = opts.scenarios[s];
+        run.https = opts.protocols[p] == "https";
+        run.keepAlive = opts.modes[m] == "keep-alive";
+        if (std::find(ALL_SCENARIOS, ALL_SCENARIOS + sizeof(ALL_SCENARIOS) / sizeof(ALL_SCENARIOS[0]), run.scenario)
+            == ALL_SCENARIOS + sizeof(ALL_SCENARIOS) / sizeof(ALL_SCENARIOS[0])) {
+          fprintf(stderr, "Unknown scenario: %s\n", run.scenario.c_str());
+          return 1;
+        }
+        results.push_back(executeRun(opts, run, sslCtx));
+      }
+    }
+  }
+  SSL_CTX_free(sslCtx);
+
+  std::string json = "{\"label\":\"" + jsonEscape(opts.label) + "\",\"timestamp\":" + std::to_string((long long)time(NULL)) +
+    ",\"host\":\"" + jsonEscape(opts.host) + "\",\"results\":[\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    json += "  " + results[i] + (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  json += "]}\n";
+
+  FILE * out = opts.output.empty() ? stdout : fopen(opts.output.c_str(), "w");
+  if (out == NULL) {
+    fprintf(stderr, "Could not open %s\n", opts.output.c_str());
+    return 1;
+  }
+  fputs(json.c_str(), out);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,592 @@
+/**
+ * Microbenchmarks for single code paths of the library, see README.md
+ *
+ * The connection benchmarks run an HTTPConnection on one end of a socket pair and act as client on
+ * the other end, so that no network stack or TLS is involved. As the handler functions are run
+ * inline, a call to HTTPConnection::loop() processes a request completely.
+ *
+ * The header benchmarks measure single header operations, one operation being one call of the
+ * function for one name.
+ *
+ * The router benchmarks measure ResourceResolver::resolveNode() for 10, 100 and 1000 registered
+ * routes, one operation being the lookup of one URL. The query benchmarks resolve a URL with a query
+ * string of eight parameters, with and without accessing them.
+ */
+#include <Arduino.h>
+
+#include <HTTPServer.hpp>
+#include <HTTPConnection.hpp>
+#include <HTTPRequest.hpp>
+#include <HTTPResponse.hpp>
+#include <HTTPHeader.hpp>
+#include <HTTPHeaders.hpp>
+#include <ResourceResolver.hpp>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "heap_stats.hpp"
+
+using namespace httpsserver;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct MicroResult {
+  std::string name;
+  uint64_t iterations;
+  double nsPerOp;
+  double allocationsPerOp;
+  // Writes to the socket per iteration (0 if not applicable)
+  double writesPerOp;
+  // Bytes per iteration, e.g. the response size (0 if not applicable)
+  uint64_t bytesPerOp;
+};
+
+void handleRoot(HTTPRequest * req, HTTPResponse * res) {
+  res->setHeader("Content-Type", "text/html");
+  res->println("<!DOCTYPE html>");
+  res->println("<html><head><title>Hello World!</title></head><body><h1>Hello World!</h1></body></html>");
+}
+
+void handleLarge(HTTPRequest * req, HTTPResponse * res) {
+  std::string sizeParam;
+  size_t size = 0;
+  if (req->getParams()->getQueryParameter("size", sizeParam)) {
+    size = strtoul(sizeParam.c_str(), NULL, 10);
+  }
+  static const char LINE[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-\n";
+  res->setHeader("Content-Type", "text/plain");
+  while (size > 0) {
+    size_t len = size < sizeof(LINE) - 1 ? size : sizeof(LINE) - 1;
+    res->write((const uint8_t *)LINE, len);
+    size -= len;
+  }
+}
+
+void handle404(HTTPRequest * req, HTTPResponse * res) {
+  req->discardRequestBody();
+  res->setStatusCode(404);
+  res->setStatusText("Not Found");
+  res->setHeader("Content-Type", "text/html");
+  res->println("<!DOCTYPE html>");
+  res->println("<html><head><title>Not Found</title></head><body><h1>404 Not Found</h1></body></html>");
+}
+
+/**
+ * Middleware that only passes the request on, to measure the cost of the chain itself
+ */
+void passMiddleware(HTTPRequest * req, HTTPResponse * res, std::function<void()> next) {
+  next();
+}
+
+/**
+ * A connection on a socket pair, with the client side in non-blocking mode
+ */
+class ConnectionPair {
+public:
+  ConnectionPair(HTTPServer * resolver, HTTPHeaders * defaultHeaders):
+    _connection(resolver),
+    _bufferPool(HTTPS_KEEPALIVE_CACHESIZE, HTTPS_KEEPALIVE_CACHE_MAXSIZE) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    // Large enough for every response, so the server never blocks while writing
+    int bufferSize = 1024 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    _clientSocket = fds[1];
+
+    sockaddr addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sa_family = AF_UNIX;
+    _connection.setAcceptedSocket(fds[0], &addr, sizeof(addr));
+    // Like the connections of an HTTPWorker
+    _connection.setBufferPool(&_bufferPool);
+    _connection.initialize(-1, defaultHeaders);
+  }
+
+  ~ConnectionPair() {
+    _connection.closeConnection();
+    close(_clientSocket);
+  }
+
+  /** Sends the request, processes it and returns the number of response bytes */
+  size_t roundTrip(const std::string &request) {
+    send(_clientSocket, request.data(), request.size(), 0);
+    _connection.loop();
+    size_t total = 0;
+    ssize_t received;
+    while ((received = recv(_clientSocket, _buffer, sizeof(_buffer), 0)) > 0) {
+      total += received;
+    }
+    return total;
+  }
+
+  bool isClosed() {
+    return _connection.isClosed();
+  }
+
+  uint32_t getWriteCount() {
+    return _connection.getWriteCount();
+  }
+
+private:
+  HTTPConnection _connection;
+  HTTPBufferPool _bufferPool;
+  int _clientSocket;
+  char _buffer[65536];
+};
+
+/**
+ * Measures a keep-alive request on an established connection, including parsing, routing, the
+ * middleware, the handler and writing the response. The middleware is added globally, or for the
+ * route group of groupPrefix if it is given.
+ */
+MicroResult benchRequest(const std::string &name, const std::string &request, double duration, size_t middleware,
+    const char * groupPrefix) {
+  HTTPServer resolver;
+  resolver.registerNode(new ResourceNode("/", "GET", &handleRoot));
+  resolver.registerNode(new ResourceNode("/large", "GET", &handleLarge));
+  resolver.setDefaultNode(new ResourceNode("", "", &handle404));
+  resolver.registerNode(new ResourceNode("/internal", "GET", &handleRoot));
+  for (size_t i = 0; i < middleware; i++) {
+    if (groupPrefix != NULL) {
+      resolver.addMiddleware(groupPrefix, &passMiddleware);
+    } else {
+      resolver.addMiddleware(&passMiddleware);
+    }
+  }
+  // Default headers like those of a typical sketch, as set by HTTPServer::setDefaultHeader()
+  HTTPHeaders defaultHeaders;
+  defaultHeaders.keepSerialized();
+  defaultHeaders.set("Server", "esp32-https-server");
+  defaultHeaders.set("Access-Control-Allow-Origin", "*");
+  defaultHeaders.set("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+  defaultHeaders.set("X-Content-Type-Options", "nosniff");
+  defaultHeaders.set("X-Frame-Options", "DENY");
+  defaultHeaders.set("Strict-Transport-Security", "max-age=31536000");
+
+  ConnectionPair pair(&resolver, &defaultHeaders);
+  // Warm-up: The first request allocates the storage that is reused afterwards
+  size_t responseSize = pair.roundTrip(request);
+
+  MicroResult result;
+  result.name = name;
+  result.iterations = 0;
+  result.bytesPerOp = responseSize;
+  uint64_t allocationsBefore = heapStatsGet().allocations;
+  uint32_t writesBefore = pair.getWriteCount();
+  Clock::time_point start = Clock::now();
+  Clock::time_point deadline = start + std::chrono::microseconds((long long)(duration * 1e6));
+  while (Clock::now() < deadline) {
+    for (int i = 0; i < 64; i++) {
+      if (pair.roundTrip(request) != responseSize || pair.isClosed()) {
+        fprintf(stderr, "%s: Unexpected response\n", name.c_str());
+        exit(1);
+      }
+    }
+    result.iterations += 64;
+  }
+  double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  result.nsPerOp = elapsedNs / result.iterations;
+  result.allocationsPerOp = (double)(heapStatsGet().allocations - allocationsBefore) / result.iterations;
+  result.writesPerOp = (double)(pair.getWriteCount() - writesBefore) / result.iterations;
+  return result;
+}
+
+/**
+ * Measures a malformed request on a new connection, like the requests of a port scanner: Accepting
+ * the socket, parsing until the error, sending the error response and closing
+ */
+MicroResult benchError(const std::string &name, const std::string &request, double duration) {
+  HTTPServer resolver;
+  HTTPConnection connection(&resolver);
+  char buffer[4096];
+
+  MicroResult result;
+  result.name = name;
+  result.iterations = 0;
+  result.bytesPerOp = 0;
+  uint64_t allocationsBefore = 0;
+  uint32_t writesBefore = 0;
+  Clock::time_point start;
+  Clock::time_point deadline;
+  // The first iteration is a warm-up and not counted
+  for (int i = -1; i < 0 || Clock::now() < deadline; i++) {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    sockaddr addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sa_family = AF_UNIX;
+    connection.setAcceptedSocket(fds[0], &addr, sizeof(addr));
+    connection.initialize(-1, NULL);
+    send(fds[1], request.data(), request.size(), 0);
+    while (!connection.isClosed()) {
+      connection.loop();
+    }
+    size_t total = 0;
+    ssize_t received;
+    while ((received = recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      total += received;
+    }
+    close(fds[1]);
+    connection.reset();
+    if (i < 0) {
+      result.bytesPerOp = total;
+      allocationsBefore = heapStatsGet().allocations;
+      writesBefore = connection.getWriteCount();
+      start = Clock::now();
+      deadline = start + std::chrono::microseconds((long long)(duration * 1e6));
+    } else if (total != result.bytesPerOp) {
+      fprintf(stderr, "%s: Unexpected response\n", name.c_str());
+      exit(1);
+    } else {
+      result.iterations++;
+    }
+  }
+  double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  result.nsPerOp = elapsedNs / result.iterations;
+  result.allocationsPerOp = (double)(heapStatsGet().allocations - allocationsBefore) / result.iterations;
+  result.writesPerOp = (double)(connection.getWriteCount() - writesBefore) / result.iterations;
+  return result;
+}
+
+// Names as they occur in requests, in various spellings
+const char * HEADER_NAMES[] = {
+  "Host", "user-agent", "Accept", "Accept-Language", "ACCEPT-ENCODING", "Connection",
+  "Upgrade-Insecure-Requests", "cache-control", "Content-Type", "content-length",
+  "Sec-WebSocket-Key", "X-Requested-With",
+};
+const size_t HEADER_NAME_COUNT = sizeof(HEADER_NAMES) / sizeof(HEADER_NAMES[0]);
+
+/**
+ * The implementation of normalizeHeaderName() before it used lookup tables, as reference
+ */
+std::string normalizeHeaderNameLocale(std::string const &name) {
+  std::locale loc;
+  std::stringbuf buf;
+  std::ostream oBuf(&buf);
+  bool upper = true;
+  std::string::size_type len = name.length();
+  for (std::string::size_type i = 0; i < len; ++i) {
+    if (upper) {
+      oBuf << std::toupper(name[i], loc);
+      upper = false;
+    } else {
+      oBuf << std::tolower(name[i], loc);
+      if (!std::isalnum(name[i], loc)) {
+        upper=true;
+      }
+    }
+  }
+  return buf.str();
+}
+
+/**
+ * Runs op(i) for i = 0, 1, 2, ... until the duration has passed. The sink keeps the compiler from
+ * removing the calls.
+ */
+template<typename Op>
+MicroResult benchLoop(const std::string &name, double duration, Op op) {
+  MicroResult result;
+  result.name = name;
+  result.iterations = 0;
+  result.bytesPerOp = 0;
+  result.writesPerOp = 0;
+  volatile size_t sink = 0;
+  uint64_t allocationsBefore = heapStatsGet().allocations;
+  Clock::time_point start = Clock::now();
+  Clock::time_point deadline = start + std::chrono::microseconds((long long)(duration * 1e6));
+  while (Clock::now() < deadline) {
+    for (int i = 0; i < 1024; i++) {
+      sink += op(result.iterations + i);
+    }
+    result.iterations += 1024;
+  }
+  double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  result.nsPerOp = elapsedNs / result.iterations;
+  result.allocationsPerOp = (double)(heapStatsGet().allocations - allocationsBefore) / result.iterations;
+  (void)sink;
+  return result;
+}
+
+void benchHeaders(const std::string &filter, double duration, std::vector<MicroResult> &results) {
+  std::vector<std::string> names(HEADER_NAMES, HEADER_NAMES + HEADER_NAME_COUNT);
+  std::vector<std::string> normalized;
+  for (size_t i = 0; i < HEADER_NAME_COUNT; i++) {
+    normalized.push_back(normalizeHeaderName(names[i]));
+  }
+
+  // Headers of a typical browser request
+  HTTPHeaders headers;
+  headers.set("Host", "192.168.4.1");
+  headers.set("User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0");
+  headers.set("Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+  headers.set("Accept-Language", "en-US,en;q=0.5");
+  headers.set("Accept-Encoding", "gzip, deflate");
+  headers.set("Connection", "keep-alive");
+  headers.set("Upgrade-Insecure-Requests", "1");
+  headers.set("Cache-Control", "max-age=0");
+
+  const char * unknownNames[] = {"accept-language", "Cache-Control", "user-agent", "X-Not-Set"};
+
+  if (std::string("headers/normalize").find(filter) != std::string::npos) {
+    results.push_back(benchLoop("headers/normalize", duration, [&](uint64_t i) {
+      return normalizeHeaderName(names[i % HEADER_NAME_COUNT]).length();
+    }));
+  }
+  if (std::string("headers/normalize-in-place").find(filter) != std::string::npos) {
+    char buffer[64];
+    results.push_back(benchLoop("headers/normalize-in-place", duration, [&](uint64_t i) {
+      const std::string &name = names[i % HEADER_NAME_COUNT];
+      memcpy(buffer, name.data(), name.length());
+      normalizeHeaderName(buffer, name.length());
+      return (size_t)buffer[0];
+    }));
+  }
+  if (std::string("headers/normalize-locale").find(filter) != std::string::npos) {
+    results.push_back(benchLoop("headers/normalize-locale", duration, [&](uint64_t i) {
+      return normalizeHeaderNameLocale(names[i % HEADER_NAME_COUNT]).length();
+    }));
+  }
+  if (std::string("headers/equals").find(filter) != std::string::npos) {
+    results.push_back(benchLoop("headers/equals", duration, [&](uint64_t i) {
+      const std::string &name = names[i % HEADER_NAME_COUNT];
+      return (size_t)headerNameEquals(name.data(), name.length(), normalized[(i / 2) % HEADER_NAME_COUNT]);
+    }));
+  }
+  if (std::string("headers/lookup-known").find(filter) != std::string::npos) {
+    const HTTPHeaderId ids[] = {HEADER_HOST, HEADER_CONNECTION, HEADER_CONTENT_LENGTH, HEADER_UPGRADE};
+    results.push_back(benchLoop("headers/lookup-known", duration, [&](uint64_t i) {
+      const char * value;
+      size_t length = 0;
+      headers.getValue(ids[i % 4], &value, &length);
+      return length;
+    }));
+  }
+  if (std::string("headers/lookup-by-name").find(filter) != std::string::npos) {
+    results.push_back(benchLoop("headers/lookup-by-name", duration, [&](uint64_t i) {
+      return headers.getValue(unknownNames[i % 4]).length();
+    }));
+  }
+}
+
+void handleNothing(HTTPRequest * req, HTTPResponse * res) {
+}
+
+/**
+ * Registers count routes like those of a REST API: Every fourth route is a collection, the others
+ * are items with a path parameter, sub-resources of an item and a POST to a collection.
+ */
+void registerRoutes(ResourceResolver &resolver, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    std::string base = "/api/v1/res" + std::to_string(i / 4);
+    switch (i % 4) {
+      case 0: resolver.registerNode(new ResourceNode(base, "GET", &handleNothing)); break;
+      case 1: resolver.registerNode(new ResourceNode(base + "/*", "GET", &handleNothing)); break;
+      case 2: resolver.registerNode(new ResourceNode(base + "/*/items", "GET", &handleNothing)); break;
+      case 3: resolver.registerNode(new ResourceNode(base, "POST", &handleNothing)); break;
+    }
+  }
+  resolver.setDefaultNode(new ResourceNode("", "", &handleNothing));
+}
+
+void benchRouter(const std::string &filter, double duration, std::vector<MicroResult> &results) {
+  const size_t routeCounts[] = {10, 100, 1000};
+  for (size_t c = 0; c < sizeof(routeCounts) / sizeof(routeCounts[0]); c++) {
+    size_t count = routeCounts[c];
+    ResourceResolver resolver;
+    registerRoutes(resolver, count);
+
+    // URLs of routes spread over the whole table, so they are not all found among the first
+    std::vector<std::string> staticUrls, paramUrls, missUrls;
+    for (size_t k = 0; k < 16; k++) {
+      size_t group = (k * 7919) % (count / 4);
+      std::string base = "/api/v1/res" + std::to_string(group);
+      staticUrls.push_back(base);
+      paramUrls.push_back(base + "/item" + std::to_string(k) + "/items?limit=10");
+      missUrls.push_back(base + "/item" + std::to_string(k) + "/unknown");
+    }
+
+    struct {
+      std::string name;
+      std::vector<std::string> * urls;
+    } lookups[] = {
+      {"router/static-" + std::to_string(count), &staticUrls},
+      {"router/param-" + std::to_string(count), &paramUrls},
+      {"router/miss-" + std::to_string(count), &missUrls},
+    };
+    for (size_t l = 0; l < sizeof(lookups) / sizeof(lookups[0]); l++) {
+      if (lookups[l].name.find(filter) == std::string::npos) {
+        continue;
+      }
+      std::vector<std::string> &urls = *lookups[l].urls;
+      results.push_back(benchLoop(lookups[l].name, duration, [&](uint64_t i) {
+        ResolvedResource resolved;
+        resolver.resolveNode("GET", urls[i % urls.size()], resolved, HANDLER_CALLBACK);
+        return (size_t)resolved.getMatchingNode();
+      }));
+    }
+  }
+}
+
+void benchQuery(const std::string &filter, double duration, std::vector<MicroResult> &results) {
+  ResourceResolver resolver;
+  registerRoutes(resolver, 100);
+  const std::string url = "/api/v1/res7/item3?sort=name&order=asc&limit=25&offset=100"
+    "&filter=status%3Dactive&fields=id%2Cname&lang=en&session=0123456789abcdef";
+
+  if (std::string("query/unused").find(filter) != std::string::npos) {
+    results.push_back(benchLoop("query/unused", duration, [&](uint64_t i) {
+      ResolvedResource resolved;
+      resolver.resolveNode("GET", url, resolved, HANDLER_CALLBACK);
+      return (size_t)resolved.getMatchingNode();
+    }));
+  }
+  if (std::string("query/lookup").find(filter) != std::string::npos) {
+    const char * names[] = {"limit", "session", "missing"};
+    results.push_back(benchLoop("query/lookup", duration, [&](uint64_t i) {
+      ResolvedResource resolved;
+      resolver.resolveNode("GET", url, resolved, HANDLER_CALLBACK);
+      std::string value;
+      size_t found = 0;
+      for (size_t n = 0; n < 3; n++) {
+        found += resolved.getParams()->getQueryParameter(names[n], value) ? 1 : 0;
+      }
+      return found;
+    }));
+  }
+}
+
+void usage(const char * name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  --duration <s>    Duration of each benchmark in seconds (default: 1)\n"
+    "  --filter <text>   Only run benchmarks whose name contains the text\n"
+    "  --label <text>    Label that is stored in the result, e.g. the commit\n"
+    "  --output <file>   Write the JSON result to the file instead of stdout\n",
+    name);
+}
+
+} /* namespace */
+
+int main(int argc, char ** argv) {
+  heapStatsInstall();
+  signal(SIGPIPE, SIG_IGN);
+
+  double duration = 1.0;
+  std::string filter;
+  std::string label;
+  std::string output;
+  for (int i = 1; i < argc; i += 2) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (arg == "--duration") {
+      duration = atof(argv[i + 1]);
+    } else if (arg == "--filter") {
+      filter = argv[i + 1];
+    } else if (arg == "--label") {
+      label = argv[i + 1];
+    } else if (arg == "--output") {
+      output = argv[i + 1];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  const std::string browserHeaders =
+    "Host: 192.168.4.1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+  struct {
+    const char * name;
+    std::string request;
+    // Number of middleware functions registered at the server
+    size_t middleware;
+    // Route group of the middleware, NULL for global middleware
+    const char * groupPrefix;
+  } requestBenchmarks[] = {
+    {"request/minimal", "GET / HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n", 0, NULL},
+    {"request/browser-headers", "GET / HTTP/1.1\r\n" + browserHeaders, 0, NULL},
+    {"request/404", "GET /does/not/exist HTTP/1.1\r\n" + browserHeaders, 0, NULL},
+    {"request/middleware-4", "GET / HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n", 4, NULL},
+    {"request/group-middleware-4", "GET /internal HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n", 4, "/internal"},
+    {"request/other-group-4", "GET / HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n", 4, "/internal"},
+    {"response/large-4k", "GET /large?size=4096 HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n", 0, NULL},
+    {"response/large-64k", "GET /large?size=65536 HTTP/1.1\r\nHost: a\r\nConnection: keep-alive\r\n\r\n", 0, NULL},
+  };
+
+  std::vector<MicroResult> results;
+  for (size_t i = 0; i < sizeof(requestBenchmarks) / sizeof(requestBenchmarks[0]); i++) {
+    if (std::string(requestBenchmarks[i].name).find(filter) == std::string::npos) {
+      continue;
+    }
+    results.push_back(benchRequest(requestBenchmarks[i].name, requestBenchmarks[i].request, duration,
+      requestBenchmarks[i].middleware, requestBenchmarks[i].groupPrefix));
+  }
+  struct {
+    const char * name;
+    std::string request;
+  } errorBenchmarks[] = {
+    {"error/bad-request", "SSH-2.0-OpenSSH_9.6\r\n"},
+    {"error/header-too-large", "GET / HTTP/1.1\r\nCookie: " + std::string(HTTPS_REQUEST_MAX_HEADER_LENGTH, 'a') + "\r\n\r\n"},
+  };
+  for (size_t i = 0; i < sizeof(errorBenchmarks) / sizeof(errorBenchmarks[0]); i++) {
+    if (std::string(errorBenchmarks[i].name).find(filter) == std::string::npos) {
+      continue;
+    }
+    results.push_back(benchError(errorBenchmarks[i].name, errorBenchmarks[i].request, duration));
+  }
+  benchHeaders(filter, duration, results);
+  benchRouter(filter, duration, results);
+  benchQuery(filter, duration, results);
+
+  std::string json = "{\"label\":\"" + label + "\",\"timestamp\":" + std::to_string((long long)time(NULL)) +
+    ",\"results\":[\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    char line[512];
+    snprintf(line, sizeof(line),
+      "  {\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"ops_per_s\":%.0f,\"allocations_per_op\":%.2f,\"writes_per_op\":%.2f,\"bytes_per_op\":%llu}%s\n",
+      results[i].name.c_str(), (unsigned long long)results[i].iterations, results[i].nsPerOp,
+      1e9 / results[i].nsPerOp, results[i].allocationsPerOp, results[i].writesPerOp, (unsigned long long)results[i].bytesPerOp, i + 1 < results.size() ? "," : "");
+    json += line;
+    fprintf(stderr, "%-28s %12.1f ns/op %12.0f ops/s %8.2f allocs/op %6.2f writes/op %8llu bytes/op\n",
+      results[i].name.c_str(), results[i].nsPerOp, 1e9 / results[i].nsPerOp, results[i].allocationsPerOp, results[i].writesPerOp, (unsigned long long)results[i].bytesPerOp);
+  }
+  json += "]}\n";
+
+  FILE * out = output.empty() ? stdout : fopen(output.c_str(), "w");
+  if (out == NULL) {
+    fprintf(stderr, "Could not open %s\n", output.c_str());
+    return 1;
+  }
+  fputs(json.c_str(), out);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
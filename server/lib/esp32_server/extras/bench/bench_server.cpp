@@ -0,0 +1,346 @@
+/**
+ * Server for the load benchmarks, see README.md
+ *
+ * Serves the same kind of resources as a typical sketch on the ESP32 over HTTP and HTTPS:
+ *
+ *   GET  /                 Small static page
+ *   POST /secret           Compares the body to a stored key, like the key check of the sketches
+ *   POST /upload           Consumes a large body and returns its length
+ *   GET  /large?size=n     Response of n bytes, written in small pieces
+ *   WS   /echo             Websocket that returns every message
+ *   GET  /static/...       Files of the static directory, see --static-dir
+ *   GET  /status           Status page in JSON, created by printing each value
+ *   GET  /status-cached    The same page, with a handler cache of 1 second
+ *   *    (anything else)   404
+ *   GET  /_bench/heap      Heap usage as JSON, ?reset=1 resets the peak afterwards
+ *   GET  /_bench/writes    Responses, socket writes, TLS records, response buffer pool hits and
+ *                          handler cache hits of the HTTP server, or of the HTTPS server with
+ *                          ?protocol=https
+ */
+#include <Arduino.h>
+
+#include <HTTPServer.hpp>
+#include <HTTPSServer.hpp>
+#include <SSLCert.hpp>
+#include <HTTPRequest.hpp>
+#include <HTTPResponse.hpp>
+#include <WebsocketHandler.hpp>
+#include <WebsocketNode.hpp>
+#include <StaticFileNode.hpp>
+#include <SPIFFS.h>
+
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+
+#include "heap_stats.hpp"
+
+// Created by extras/host/create-example-cert.sh during the build
+#include "cert.h"
+#include "private_key.h"
+
+using namespace httpsserver;
+
+namespace {
+
+const char * SECRET_KEY = "c2VjcmV0LWtleS1vZi10aGUtYmVuY2htYXJrLXNlcnZlcg==";
+
+volatile sig_atomic_t stopRequested = 0;
+
+HTTPServer * insecureServerPtr = NULL;
+HTTPServer * secureServerPtr = NULL;
+int workerCount = 0;
+
+void onSignal(int) {
+  stopRequested = 1;
+}
+
+void handleRoot(HTTPRequest * req, HTTPResponse * res) {
+  res->setHeader("Content-Type", "text/html");
+  res->println("<!DOCTYPE html>");
+  res->println("<html>");
+  res->println("<head><title>Hello World!</title></head>");
+  res->println("<body><h1>Hello World!</h1><p>This page is served by the benchmark server.</p></body>");
+  res->println("</html>");
+}
+
+void handleSecret(HTTPRequest * req, HTTPResponse * res) {
+  std::string payload;
+  char buffer[64];
+  while (!req->requestComplete()) {
+    size_t len = req->readBytes((byte *)buffer, sizeof(buffer));
+    if (len == 0) {
+      break;
+    }
+    payload.append(buffer, len);
+  }
+
+  res->setHeader("Content-Type", "text/plain");
+  if (payload == SECRET_KEY) {
+    res->setStatusCode(200);
+    res->println("The client key and the stored key matches (200).");
+  } else {
+    res->setStatusCode(401);
+    res->setStatusText("Unauthorized");
+    res->println("The client key and the stored key does not match (401).");
+  }
+}
+
+void handleUpload(HTTPRequest * req, HTTPResponse * res) {
+  byte buffer[512];
+  size_t total = 0;
+  while (!req->requestComplete()) {
+    size_t len = req->readBytes(buffer, sizeof(buffer));
+    if (len == 0) {
+      break;
+    }
+    total += len;
+  }
+  res->setHeader("Content-Type", "text/plain");
+  res->printf("%u\n", (unsigned)total);
+}
+
+void handleLarge(HTTPRequest * req, HTTPResponse * res) {
+  std::string sizeParam;
+  size_t size = 65536;
+  if (req->getParams()->getQueryParameter("size", sizeParam)) {
+    size = strtoul(sizeParam.c_str(), NULL, 10);
+  }
+
+  // Write in small pieces, like a sketch that prints a generated page
+  static const char LINE[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-\n";
+  res->setHeader("Content-Type", "text/plain");
+  while (size > 0) {
+    size_t len = size < sizeof(LINE) - 1 ? size : sizeof(LINE) - 1;
+    res->write((const uint8_t *)LINE, len);
+    size -= len;
+  }
+}
+
+void handleStatus(HTTPRequest * req, HTTPResponse * res) {
+  // Like the device info page of a sketch, which prints many values one by one
+  res->setHeader("Content-Type", "application/json");
+  res->print("{\"uptime\":");
+  res->print(millis() / 1000);
+  res->print(",\"sensors\":[");
+  for (int i = 0; i < 32; i++) {
+    res->printf("%s{\"id\":%d,\"name\":\"sensor-%02d\",\"value\":%d.%02d}", i > 0 ? "," : "", i, i, 20 + i % 7, (i * 37) % 100);
+  }
+  res->print("]}");
+}
+
+void handleHeap(HTTPRequest * req, HTTPResponse * res) {
+  HeapStats stats = heapStatsGet();
+  res->setHeader("Content-Type", "application/json");
+  res->printf("{\"current_bytes\":%lu,\"peak_bytes\":%lu,\"allocations\":%llu}",
+    (unsigned long)stats.currentBytes, (unsigned long)stats.peakBytes, (unsigned long long)stats.allocations);
+  if (req->getParams()->isQueryParameterSet("reset")) {
+    heapStatsResetPeak();
+  }
+}
+
+void handleWrites(HTTPRequest * req, HTTPResponse * res) {
+  std::string protocol;
+  req->getParams()->getQueryParameter("protocol", protocol);
+  HTTPServer * server = protocol == "https" ? secureServerPtr : insecureServerPtr;
+  unsigned long long responses = 0, writes = 0, records = 0, poolHits = 0, poolMisses = 0;
+  for (int i = 0; i < (workerCount > 0 ? workerCount : 1); i++) {
+    HTTPWorkerStats stats = server->getWorkerStats(i);
+    responses += stats.responses;
+    writes += stats.socketWrites;
+    records += stats.tlsRecords;
+    poolHits += stats.responseBuffers.hits;
+    poolMisses += stats.responseBuffers.misses;
+  }
+  HTTPHandlerCacheStats cacheStats = server->getHandlerCacheStats();
+  res->setHeader("Content-Type", "application/json");
+  res->printf("{\"responses\":%llu,\"writes\":%llu,\"records\":%llu,\"pool_hits\":%llu,\"pool_misses\":%llu,"
+    "\"cache_hits\":%lu,\"cache_misses\":%lu,\"cache_bytes\":%lu}",
+    responses, writes, records, poolHits, poolMisses,
+    (unsigned long)cacheStats.hits, (unsigned long)cacheStats.misses, (unsigned long)cacheStats.bytes);
+}
+
+void handle404(HTTPRequest * req, HTTPResponse * res) {
+  req->discardRequestBody();
+  res->setStatusCode(404);
+  res->setStatusText("Not Found");
+  res->setHeader("Content-Type", "text/html");
+  res->println("<!DOCTYPE html>");
+  res->println("<html>");
+  res->println("<head><title>Not Found</title></head>");
+  res->println("<body><h1>404 Not Found</h1><p>The requested resource was not found on this server.</p></body>");
+  res->println("</html>");
+}
+
+class EchoHandler : public WebsocketHandler {
+public:
+  static WebsocketHandler * create() {
+    return new EchoHandler();
+  }
+
+  void onMessage(WebsocketInputStreambuf * inbuf) {
+    std::ostringstream ss;
+    ss << inbuf;
+    send(ss.str(), SEND_TYPE_TEXT);
+  }
+};
+
+void registerNodes(ResourceResolver * server) {
+  server->registerNode(new ResourceNode("/", "GET", &handleRoot));
+  server->registerNode(new ResourceNode("/secret", "POST", &handleSecret));
+  server->registerNode(new ResourceNode("/upload", "POST", &handleUpload));
+  server->registerNode(new ResourceNode("/large", "GET", &handleLarge));
+  server->registerNode(new ResourceNode("/_bench/heap", "GET", &handleHeap));
+  server->registerNode(new ResourceNode("/_bench/writes", "GET", &handleWrites));
+  server->registerNode(new WebsocketNode("/echo", &EchoHandler::create));
+  server->registerNode(new StaticFileNode("/static", SPIFFS, "/"));
+  server->registerNode(new ResourceNode("/status", "GET", &handleStatus));
+  ResourceNode * statusCached = new ResourceNode("/status-cached", "GET", &handleStatus);
+  statusCached->setHandlerCacheTTL(1000);
+  server->registerNode(statusCached);
+  server->setDefaultNode(new ResourceNode("", "", &handle404));
+}
+
+void usage(const char * name) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  --port <n>             HTTP port, HTTPS uses port+1 (default: 8080)\n"
+    "  --max-connections <n>  Connection slots per server (default: 16)\n"
+    "  --workers <n>          Worker threads per server, 0 processes connections in loop() (default: 0)\n"
+    "  --static-dir <dir>     Directory served below /static/ (default: a temporary directory with\n"
+    "                         index.html, file.bin and file.bin.gz)\n"
+    "  --static-size <bytes>  Size of file.bin in the temporary directory (default: 65536)\n",
+    name);
+}
+
+/**
+ * Creates a temporary directory with the files for the static scenarios
+ */
+std::string createStaticDir(size_t fileSize) {
+  char dir[] = "/tmp/bench-static-XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    return std::string();
+  }
+  std::string path = dir;
+  FILE * index = fopen((path + "/index.html").c_str(), "w");
+  FILE * file = fopen((path + "/file.bin").c_str(), "w");
+  FILE * sidecar = fopen((path + "/file.bin.gz").c_str(), "w");
+  if (index == NULL || file == NULL || sidecar == NULL) {
+    return std::string();
+  }
+  fputs("<!DOCTYPE html>\n<html><head><title>Static</title></head><body><h1>Static page</h1></body></html>\n", index);
+  fclose(index);
+  static const char LINE[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ-\n";
+  for (size_t i = 0; i < fileSize; i++) {
+    fputc(LINE[i % (sizeof(LINE) - 1)], file);
+  }
+  fclose(file);
+  // Stands in for a compressed sidecar. Only its size matters to the benchmark, which is a
+  // quarter of the file, as for typical web assets.
+  for (size_t i = 0; i < fileSize / 4; i++) {
+    fputc(LINE[i % (sizeof(LINE) - 1)], sidecar);
+  }
+  fclose(sidecar);
+  return path;
+}
+
+void removeStaticDir(const std::string &path) {
+  unlink((path + "/index.html").c_str());
+  unlink((path + "/file.bin").c_str());
+  unlink((path + "/file.bin.gz").c_str());
+  rmdir(path.c_str());
+}
+
+} /* namespace */
+
+int main(int argc, char ** argv) {
+  heapStatsInstall();
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  int port = 8080;
+  int maxConnections = 16;
+  int workers = 0;
+  std::string staticDir;
+  size_t staticSize = 65536;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 < argc && arg == "--port") {
+      port = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--max-connections") {
+      maxConnections = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--workers") {
+      workers = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--static-dir") {
+      staticDir = argv[++i];
+    } else if (i + 1 < argc && arg == "--static-size") {
+      staticSize = strtoul(argv[++i], NULL, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (port <= 0 || port >= 65535 || maxConnections <= 0 || maxConnections > 255 || workers < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  // The host implementation of SPIFFS serves the directory given by HTTPS_HOST_FS_ROOT
+  bool temporaryStaticDir = staticDir.empty();
+  if (temporaryStaticDir) {
+    staticDir = createStaticDir(staticSize);
+    if (staticDir.empty()) {
+      fprintf(stderr, "Could not create the static directory\n");
+      return 1;
+    }
+  }
+  setenv("HTTPS_HOST_FS_ROOT", staticDir.c_str(), 1);
+  SPIFFS.begin();
+
+  SSLCert cert(example_crt_DER, example_crt_DER_len, example_key_DER, example_key_DER_len);
+  HTTPServer insecureServer(port, maxConnections);
+  HTTPSServer secureServer(&cert, port + 1, maxConnections);
+  insecureServerPtr = &insecureServer;
+  secureServerPtr = &secureServer;
+  workerCount = workers;
+  registerNodes(&insecureServer);
+  registerNodes(&secureServer);
+  if (workers > 0) {
+    insecureServer.setWorkerCount(workers);
+    secureServer.setWorkerCount(workers);
+  }
+
+  if (insecureServer.start() == 0 || secureServer.start() == 0) {
+    fprintf(stderr, "Could not start the servers on ports %d and %d\n", port, port + 1);
+    if (temporaryStaticDir) {
+      removeStaticDir(staticDir);
+    }
+    return 1;
+  }
+  printf("Benchmark server ready: http://127.0.0.1:%d/ https://127.0.0.1:%d/\n", port, port + 1);
+
+  while (!stopRequested) {
+    insecureServer.loop();
+    secureServer.loop();
+    if (workers > 0) {
+      // The main thread only accepts connections
+      sched_yield();
+    }
+  }
+
+  insecureServer.stop();
+  secureServer.stop();
+  if (temporaryStaticDir) {
+    removeStaticDir(staticDir);
+  }
+  return 0;
+}
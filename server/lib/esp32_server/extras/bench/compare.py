@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""
+Compares two result files of run.sh and prints the relative change of each value.
+
+Usage: compare.py <baseline.json> <candidate.json>
+"""
+import json
+import sys
+
+LOAD_VALUES = [
+    # name, key, True if higher is better
+    ("req/s", lambda r: r["req_per_s"], True),
+    ("p50", lambda r: r["latency_us"]["p50"], False),
+    ("p99", lambda r: r["latency_us"]["p99"], False),
+    ("p999", lambda r: r["latency_us"]["p999"], False),
+    ("hs/s", lambda r: r["handshakes_per_s"], True),
+    ("heap", lambda r: r["heap_peak_bytes"], False),
+    ("writes", lambda r: r.get("writes_per_request", 0), False),
+]
+
+MICRO_VALUES = [
+    ("ns/op", lambda r: r["ns_per_op"], False),
+    ("allocs/op", lambda r: r["allocations_per_op"], False),
+    ("writes/op", lambda r: r.get("writes_per_op", 0), False),
+]
+
+
+def change(old, new, higher_is_better):
+    if old == 0:
+        return "     n/a"
+    delta = (new - old) * 100.0 / old
+    marker = ""
+    if abs(delta) >= 5:
+        marker = "+" if (delta > 0) == higher_is_better else "-"
+    return "%+7.1f%%%s" % (delta, marker)
+
+
+def compare(title, baseline, candidate, key, values):
+    old_results = {key(r): r for r in baseline}
+    print(title)
+    for result in candidate:
+        old = old_results.get(key(result))
+        if old is None:
+            continue
+        columns = ["%s %s" % (name, change(get(old), get(result), better)) for name, get, better in values]
+        print("  %-32s %s" % (key(result), "  ".join(columns)))
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip())
+        return 1
+    with open(sys.argv[1]) as f:
+        baseline = json.load(f)
+    with open(sys.argv[2]) as f:
+        candidate = json.load(f)
+
+    print("Baseline: %s, candidate: %s (+ better, - worse by at least 5%%)" %
+          (baseline["load"]["label"], candidate["load"]["label"]))
+    compare("Load", baseline["load"]["results"], candidate["load"]["results"],
+            lambda r: "%s %s %s" % (r["scenario"], r["protocol"], "keep-alive" if r["keep_alive"] else "close"),
+            LOAD_VALUES)
+    compare("Micro", baseline["micro"]["results"], candidate["micro"]["results"], lambda r: r["name"], MICRO_VALUES)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
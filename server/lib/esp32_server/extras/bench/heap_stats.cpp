@@ -0,0 +1,130 @@
+#include "heap_stats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <openssl/crypto.h>
+
+namespace {
+
+std::atomic<size_t> currentBytes(0);
+std::atomic<size_t> peakBytes(0);
+std::atomic<uint64_t> allocations(0);
+
+// Each block is preceded by its size, so that free() can update the counters. The header keeps
+// the alignment of malloc()
+union BlockHeader {
+  size_t size;
+  max_align_t align;
+};
+
+void * trackedAlloc(size_t size) {
+  BlockHeader * header = (BlockHeader *)malloc(sizeof(BlockHeader) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  header->size = size;
+  size_t current = currentBytes.fetch_add(size) + size;
+  size_t peak = peakBytes.load();
+  while (current > peak && !peakBytes.compare_exchange_weak(peak, current));
+  allocations++;
+  return header + 1;
+}
+
+void trackedFree(void * ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  BlockHeader * header = ((BlockHeader *)ptr) - 1;
+  currentBytes -= header->size;
+  free(header);
+}
+
+void * trackedRealloc(void * ptr, size_t size) {
+  if (ptr == NULL) {
+    return trackedAlloc(size);
+  }
+  if (size == 0) {
+    trackedFree(ptr);
+    return NULL;
+  }
+  void * newPtr = trackedAlloc(size);
+  if (newPtr != NULL) {
+    size_t oldSize = (((BlockHeader *)ptr) - 1)->size;
+    memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+    trackedFree(ptr);
+  }
+  return newPtr;
+}
+
+void * opensslAlloc(size_t size, const char *, int) {
+  return trackedAlloc(size);
+}
+
+void * opensslRealloc(void * ptr, size_t size, const char *, int) {
+  return trackedRealloc(ptr, size);
+}
+
+void opensslFree(void * ptr, const char *, int) {
+  trackedFree(ptr);
+}
+
+void * allocOrThrow(size_t size) {
+  void * ptr = trackedAlloc(size == 0 ? 1 : size);
+  if (ptr == NULL) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+} /* namespace */
+
+void heapStatsInstall() {
+  CRYPTO_set_mem_functions(opensslAlloc, opensslRealloc, opensslFree);
+}
+
+HeapStats heapStatsGet() {
+  HeapStats stats;
+  stats.currentBytes = currentBytes.load();
+  stats.peakBytes = peakBytes.load();
+  stats.allocations = allocations.load();
+  return stats;
+}
+
+void heapStatsResetPeak() {
+  peakBytes = currentBytes.load();
+}
+
+void * operator new(size_t size) {
+  return allocOrThrow(size);
+}
+
+void * operator new[](size_t size) {
+  return allocOrThrow(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+  return trackedAlloc(size == 0 ? 1 : size);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return trackedAlloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void * ptr) noexcept {
+  trackedFree(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+  trackedFree(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) noexcept {
+  trackedFree(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept {
+  trackedFree(ptr);
+}
@@ -0,0 +1,28 @@
+#ifndef EXTRAS_BENCH_HEAP_STATS_HPP_
+#define EXTRAS_BENCH_HEAP_STATS_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Heap accounting for the benchmarks.
+ *
+ * Linking heap_stats.cpp replaces the global operator new/delete, and heapStatsInstall() routes
+ * the allocations of OpenSSL through the same counters. The ESP32 reports the free heap instead,
+ * but on the host, the bytes in use by the server process are the comparable value.
+ */
+struct HeapStats {
+  /** Bytes that are currently allocated */
+  size_t currentBytes;
+  /** Maximum of currentBytes since the start or the last call to heapStatsResetPeak() */
+  size_t peakBytes;
+  /** Number of allocations since the start */
+  uint64_t allocations;
+};
+
+/** Must be called at the beginning of main(), before OpenSSL allocates anything */
+void heapStatsInstall();
+HeapStats heapStatsGet();
+void heapStatsResetPeak();
+
+#endif /* EXTRAS_BENCH_HEAP_STATS_HPP_ */
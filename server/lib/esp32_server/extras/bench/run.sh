@@ -0,0 +1,56 @@
+#!/bin/bash
+# Runs the load benchmarks and the microbenchmarks and writes the results as JSON.
+#
+# Usage: run.sh <build directory> <output file> [options for bench_client]
+#
+# The build directory is the one passed to cmake -B. Build it with -DHTTPS_LOGLEVEL=1, as the log
+# output of the default level slows the server down considerably.
+#
+# Environment variables:
+#   BENCH_PORT        HTTP port of the server, HTTPS uses BENCH_PORT+1 (default: 18080)
+#   BENCH_SERVER_ARGS Additional options for bench_server, e.g. "--workers 2"
+#   BENCH_LABEL       Label of the result (default: output of git describe)
+set -e
+
+BUILDDIR="$1"
+OUTPUT="$2"
+if [[ "$BUILDDIR" == "" || "$OUTPUT" == "" ]]; then
+  echo "Usage: $0 <build directory> <output file> [options for bench_client]"
+  exit 1
+fi
+shift 2
+
+BENCHDIR="$BUILDDIR/bench"
+PORT="${BENCH_PORT:-18080}"
+LABEL="${BENCH_LABEL:-$(git -C "$(dirname "$0")" describe --always --dirty 2>/dev/null || echo unknown)}"
+TMPDIR="$(mktemp -d)"
+trap 'kill $SERVER_PID 2>/dev/null || true; rm -rf "$TMPDIR"' EXIT
+
+"$BENCHDIR/bench_server" --port "$PORT" $BENCH_SERVER_ARGS > "$TMPDIR/server.log" 2>&1 &
+SERVER_PID=$!
+for i in $(seq 1 50); do
+  if grep -q "ready" "$TMPDIR/server.log"; then
+    break
+  fi
+  if ! kill -0 $SERVER_PID 2>/dev/null; then
+    cat "$TMPDIR/server.log"
+    exit 1
+  fi
+  sleep 0.1
+done
+
+"$BENCHDIR/bench_client" --port "$PORT" --label "$LABEL" --output "$TMPDIR/load.json" "$@"
+kill $SERVER_PID
+wait $SERVER_PID 2>/dev/null || true
+
+"$BENCHDIR/bench_micro" --label "$LABEL" --output "$TMPDIR/micro.json"
+
+# Both results go into one file: {"load": {...}, "micro": {...}}
+{
+  echo "{\"load\":"
+  cat "$TMPDIR/load.json"
+  echo ",\"micro\":"
+  cat "$TMPDIR/micro.json"
+  echo "}"
+} > "$OUTPUT"
+echo "Results written to $OUTPUT"
@@ -0,0 +1,38 @@
+#!/bin/bash
+# Creates cert.h and private_key.h for building the examples on the host.
+#
+# Usage: create-example-cert.sh <output directory>
+#
+# Unlike extras/create_cert.sh, the certificate is self-signed, and the files are only written
+# to the output directory, so that the example directories are not modified.
+set -e
+
+OUTDIR="$1"
+if [[ "$OUTDIR" == "" ]]; then
+  echo "No output directory specified. Stop."
+  exit 1
+fi
+mkdir -p "$OUTDIR"
+cd "$OUTDIR"
+
+openssl req -x509 -newkey rsa:2048 -nodes -days 3650 -subj "/C=DE/ST=BE/L=Berlin/O=MyCompany/CN=esp32.local" \
+  -keyout example.key -out example.crt 2>/dev/null
+# The server expects a PKCS#1 key. OpenSSL 3 needs -traditional for that, older versions use it by default
+openssl rsa -in example.key -outform DER -out example.key.DER -traditional 2>/dev/null || \
+  openssl rsa -in example.key -outform DER -out example.key.DER 2>/dev/null
+openssl x509 -in example.crt -outform DER -out example.crt.DER
+
+# The variable names are derived from the file names (example_crt_DER, example_key_DER)
+echo "#ifndef CERT_H_" > cert.h.tmp
+echo "#define CERT_H_" >> cert.h.tmp
+xxd -i example.crt.DER >> cert.h.tmp
+echo "#endif" >> cert.h.tmp
+
+echo "#ifndef PRIVATE_KEY_H_" > private_key.h.tmp
+echo "#define PRIVATE_KEY_H_" >> private_key.h.tmp
+xxd -i example.key.DER >> private_key.h.tmp
+echo "#endif" >> private_key.h.tmp
+
+mv cert.h.tmp cert.h
+mv private_key.h.tmp private_key.h
+rm -f example.key example.crt example.key.DER example.crt.DER
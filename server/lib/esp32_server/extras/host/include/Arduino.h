@@ -0,0 +1,145 @@
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+/**
+ * Minimal Arduino core for building the library and its examples on a Linux host.
+ *
+ * Only the parts that are used by the library and the examples are provided.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT  0x01
+#define OUTPUT 0x02
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// GPIOs do not exist on the host. Writes are ignored, reads return LOW
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+/**
+ * Interface for classes that can be printed with Print::print()
+ */
+class Print;
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+/**
+ * Base class for everything that outputs characters (Serial, HTTPResponse, ...)
+ */
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return (str == NULL ? 0 : write((const uint8_t *)str, strlen(str)));
+  }
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  size_t print(const char str[]);
+  size_t print(char c);
+  size_t print(unsigned char b, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+  size_t print(const Printable &p);
+
+  size_t println();
+  size_t println(const char str[]);
+  size_t println(char c);
+  size_t println(unsigned char b, int base = DEC);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+  size_t println(double n, int digits = 2);
+  size_t println(const Printable &p);
+
+  virtual void flush() {}
+
+private:
+  size_t printNumber(unsigned long n, uint8_t base);
+};
+
+/**
+ * Serial port, mapped to stdout (output) and stdin (input)
+ */
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) {}
+  void end() {}
+  int available();
+  int read();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+  void flush();
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// Logging of the ESP-IDF is not available
+#define ESP_LOGE(tag, ...) do {} while (0)
+#define ESP_LOGW(tag, ...) do {} while (0)
+#define ESP_LOGI(tag, ...) do {} while (0)
+#define ESP_LOGD(tag, ...) do {} while (0)
+#define ESP_LOGV(tag, ...) do {} while (0)
+
+// FreeRTOS tasks are mapped to threads
+#define ARDUINO_RUNNING_CORE 1
+typedef void (*TaskFunction_t)(void *);
+typedef void * TaskHandle_t;
+typedef int BaseType_t;
+#define pdPASS 1
+#define pdFAIL 0
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stackDepth,
+  void * parameters, unsigned int priority, TaskHandle_t * createdTask, int coreId);
+BaseType_t xTaskCreate(TaskFunction_t function, const char * name, uint32_t stackDepth,
+  void * parameters, unsigned int priority, TaskHandle_t * createdTask);
+
+// Entry points of a sketch
+void setup();
+void loop();
+
+// Included last, as IPAddress depends on Printable
+#include <IPAddress.h>
+
+#endif /* HOST_ARDUINO_H_ */
@@ -0,0 +1,80 @@
+#ifndef HOST_FS_H_
+#define HOST_FS_H_
+
+#include <Arduino.h>
+
+#include <time.h>
+
+#include <memory>
+#include <string>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+class FileImpl;
+
+/**
+ * File or directory on the host file system
+ */
+class File : public Print {
+public:
+  File(std::shared_ptr<FileImpl> impl = std::shared_ptr<FileImpl>());
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+
+  int available();
+  int read();
+  size_t read(uint8_t * buffer, size_t size);
+  int peek();
+  void flush();
+  bool seek(uint32_t pos);
+  size_t position() const;
+  size_t size() const;
+  time_t getLastWrite();
+  void close();
+  operator bool() const;
+
+  const char * name() const;
+  bool isDirectory();
+  File openNextFile(const char * mode = FILE_READ);
+  void rewindDirectory();
+
+private:
+  std::shared_ptr<FileImpl> _impl;
+};
+
+/**
+ * File system that is backed by a directory on the host
+ */
+class FS {
+public:
+  FS(const char * rootEnvironmentVariable, const char * defaultRoot);
+
+  File open(const char * path, const char * mode = FILE_READ);
+  File open(const std::string &path, const char * mode = FILE_READ) { return open(path.c_str(), mode); }
+  bool exists(const char * path);
+  bool exists(const std::string &path) { return exists(path.c_str()); }
+  bool remove(const char * path);
+  bool rename(const char * pathFrom, const char * pathTo);
+  bool mkdir(const char * path);
+  bool rmdir(const char * path);
+
+protected:
+  std::string hostPath(const char * path);
+  bool mountRoot(bool create);
+
+  const char * _rootEnvironmentVariable;
+  const char * _defaultRoot;
+};
+
+} /* namespace fs */
+
+using fs::FS;
+using fs::File;
+
+#endif /* HOST_FS_H_ */
@@ -0,0 +1,26 @@
+#ifndef HOST_IPADDRESS_H_
+#define HOST_IPADDRESS_H_
+
+#include <Arduino.h>
+
+/**
+ * IPv4 address in network byte order, like the ESP32's IPAddress
+ */
+class IPAddress : public Printable {
+public:
+  IPAddress(): _address(0) {}
+  IPAddress(uint32_t address): _address(address) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d):
+    _address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+
+  operator uint32_t() const { return _address; }
+  uint8_t operator[](int index) const { return (_address >> (8 * index)) & 0xFF; }
+  bool operator==(const IPAddress &other) const { return _address == other._address; }
+
+  virtual size_t printTo(Print &p) const;
+
+private:
+  uint32_t _address;
+};
+
+#endif /* HOST_IPADDRESS_H_ */
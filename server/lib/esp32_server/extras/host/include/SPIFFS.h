@@ -0,0 +1,26 @@
+#ifndef HOST_SPIFFS_H_
+#define HOST_SPIFFS_H_
+
+#include <FS.h>
+
+namespace fs {
+
+/**
+ * SPIFFS on the host: The files are stored in the directory given by the environment variable
+ * HTTPS_HOST_FS_ROOT, or in ./data if it is not set.
+ */
+class SPIFFSFS : public FS {
+public:
+  SPIFFSFS();
+  bool begin(bool formatOnFail = false, const char * basePath = "/spiffs", uint8_t maxOpenFiles = 10);
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+  void end() {}
+};
+
+} /* namespace fs */
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif /* HOST_SPIFFS_H_ */
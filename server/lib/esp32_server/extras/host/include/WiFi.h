@@ -0,0 +1,26 @@
+#ifndef HOST_WIFI_H_
+#define HOST_WIFI_H_
+
+#include <Arduino.h>
+
+#define WL_IDLE_STATUS   0
+#define WL_CONNECTED     3
+#define WL_DISCONNECTED  6
+
+#define WIFI_STA 1
+#define WIFI_AP  2
+
+/**
+ * The host is always connected. Credentials are ignored, and the server listens on all interfaces.
+ */
+class WiFiClass {
+public:
+  int begin(const char * ssid, const char * passphrase = NULL) { return WL_CONNECTED; }
+  bool mode(int m) { return true; }
+  int status() { return WL_CONNECTED; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif /* HOST_WIFI_H_ */
@@ -0,0 +1,23 @@
+#ifndef HOST_ESP32_SHA_H_
+#define HOST_ESP32_SHA_H_
+
+#include <stddef.h>
+
+// OpenSSL declares a function SHA1(), which collides with the enum value of the ESP32. By
+// including it first and renaming the enum value, both can be used in the same file.
+#include <openssl/sha.h>
+#define SHA1 HOST_ESP_SHA1
+
+/**
+ * Software replacement for the SHA accelerator of the ESP32. Only SHA1 is used by the library.
+ */
+typedef enum {
+  HOST_ESP_SHA1 = 0,
+  SHA2_256,
+  SHA2_384,
+  SHA2_512,
+} esp_sha_type;
+
+void esp_sha(esp_sha_type type, const unsigned char *input, size_t ilen, unsigned char *output);
+
+#endif /* HOST_ESP32_SHA_H_ */
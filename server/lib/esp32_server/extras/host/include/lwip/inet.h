@@ -0,0 +1,6 @@
+#ifndef HOST_LWIP_INET_H_
+#define HOST_LWIP_INET_H_
+
+#include <arpa/inet.h>
+
+#endif /* HOST_LWIP_INET_H_ */
@@ -0,0 +1,6 @@
+#ifndef HOST_LWIP_NETDB_H_
+#define HOST_LWIP_NETDB_H_
+
+#include <netdb.h>
+
+#endif /* HOST_LWIP_NETDB_H_ */
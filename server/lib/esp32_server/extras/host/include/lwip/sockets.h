@@ -0,0 +1,14 @@
+#ifndef HOST_LWIP_SOCKETS_H_
+#define HOST_LWIP_SOCKETS_H_
+
+// lwIP provides the BSD socket API on the ESP32, the host uses POSIX sockets directly
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#endif /* HOST_LWIP_SOCKETS_H_ */
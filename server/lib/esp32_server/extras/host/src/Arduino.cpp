@@ -0,0 +1,255 @@
+#include <Arduino.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+
+}
+
+int digitalRead(uint8_t pin) {
+  return LOW;
+}
+
+static std::minstd_rand randomGenerator;
+
+long random(long howbig) {
+  if (howbig <= 0) {
+    return 0;
+  }
+  return randomGenerator() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    randomGenerator.seed(seed);
+  }
+}
+
+/**
+ * Parameters for a task that is run as thread
+ */
+struct HostTask {
+  TaskFunction_t function;
+  void * parameters;
+};
+
+static void * runTask(void * arg) {
+  HostTask task = *(HostTask*)arg;
+  delete (HostTask*)arg;
+  task.function(task.parameters);
+  return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stackDepth,
+    void * parameters, unsigned int priority, TaskHandle_t * createdTask, int coreId) {
+  return xTaskCreate(function, name, stackDepth, parameters, priority, createdTask);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char * name, uint32_t stackDepth,
+    void * parameters, unsigned int priority, TaskHandle_t * createdTask) {
+  // The stack sizes are chosen for the ESP32 and are too small for the host, so we use the default
+  pthread_t thread;
+  HostTask * task = new HostTask{function, parameters};
+  if (pthread_create(&thread, NULL, &runTask, task) != 0) {
+    delete task;
+    return pdFAIL;
+  }
+  pthread_detach(thread);
+  if (createdTask != NULL) {
+    *createdTask = (TaskHandle_t)thread;
+  }
+  return pdPASS;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) {
+      n++;
+    } else {
+      break;
+    }
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char staticBuffer[64];
+  char * buffer = staticBuffer;
+  va_list arg;
+  va_start(arg, format);
+  int len = vsnprintf(staticBuffer, sizeof(staticBuffer), format, arg);
+  va_end(arg);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len >= sizeof(staticBuffer)) {
+    buffer = new char[len + 1];
+    va_start(arg, format);
+    vsnprintf(buffer, len + 1, format, arg);
+    va_end(arg);
+  }
+  len = write((const uint8_t*)buffer, len);
+  if (buffer != staticBuffer) {
+    delete[] buffer;
+  }
+  return len;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char * str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::print(const char str[]) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char b, int base) {
+  return print((unsigned long)b, base);
+}
+
+size_t Print::print(int n, int base) {
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+  if (base == 10 && n < 0) {
+    return print('-') + printNumber(-(unsigned long)n, 10);
+  }
+  return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+  return printf("%.*f", digits, n);
+}
+
+size_t Print::print(const Printable &p) {
+  return p.printTo(*this);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::println(const char str[]) {
+  return print(str) + println();
+}
+
+size_t Print::println(char c) {
+  return print(c) + println();
+}
+
+size_t Print::println(unsigned char b, int base) {
+  return print(b, base) + println();
+}
+
+size_t Print::println(int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits) {
+  return print(n, digits) + println();
+}
+
+size_t Print::println(const Printable &p) {
+  return print(p) + println();
+}
+
+size_t IPAddress::printTo(Print &p) const {
+  return p.printf("%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+}
+
+int HardwareSerial::available() {
+  struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+  return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+  return available() ? getchar() : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
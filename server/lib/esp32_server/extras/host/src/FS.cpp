@@ -0,0 +1,302 @@
+#include <FS.h>
+#include <SPIFFS.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace fs {
+
+/**
+ * State of an opened file or directory
+ */
+class FileImpl {
+public:
+  FileImpl(const std::string &name, const std::string &hostPath, FILE * file, DIR * dir):
+    _name(name),
+    _hostPath(hostPath),
+    _file(file),
+    _dir(dir) {
+  }
+
+  ~FileImpl() {
+    close();
+  }
+
+  void close() {
+    if (_file != NULL) {
+      fclose(_file);
+      _file = NULL;
+    }
+    if (_dir != NULL) {
+      closedir(_dir);
+      _dir = NULL;
+    }
+  }
+
+  // Path as seen by the sketch (e.g. "/public/index.html")
+  std::string _name;
+  // Path on the host
+  std::string _hostPath;
+  FILE * _file;
+  DIR * _dir;
+};
+
+File::File(std::shared_ptr<FileImpl> impl):
+  _impl(impl) {
+
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+  if (!_impl || _impl->_file == NULL) {
+    return 0;
+  }
+  return fwrite(buffer, 1, size, _impl->_file);
+}
+
+int File::available() {
+  if (!_impl || _impl->_file == NULL) {
+    return 0;
+  }
+  return size() - position();
+}
+
+int File::read() {
+  uint8_t c;
+  return (read(&c, 1) == 1 ? c : -1);
+}
+
+size_t File::read(uint8_t * buffer, size_t size) {
+  if (!_impl || _impl->_file == NULL) {
+    return 0;
+  }
+  return fread(buffer, 1, size, _impl->_file);
+}
+
+int File::peek() {
+  if (!_impl || _impl->_file == NULL) {
+    return -1;
+  }
+  int c = fgetc(_impl->_file);
+  if (c != EOF) {
+    ungetc(c, _impl->_file);
+  }
+  return (c == EOF ? -1 : c);
+}
+
+void File::flush() {
+  if (_impl && _impl->_file != NULL) {
+    fflush(_impl->_file);
+  }
+}
+
+bool File::seek(uint32_t pos) {
+  return _impl && _impl->_file != NULL && fseek(_impl->_file, pos, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  if (!_impl || _impl->_file == NULL) {
+    return 0;
+  }
+  long pos = ftell(_impl->_file);
+  return (pos < 0 ? 0 : pos);
+}
+
+size_t File::size() const {
+  if (!_impl || _impl->_file == NULL) {
+    return 0;
+  }
+  fflush(_impl->_file);
+  struct stat st;
+  if (fstat(fileno(_impl->_file), &st) != 0) {
+    return 0;
+  }
+  return st.st_size;
+}
+
+time_t File::getLastWrite() {
+  if (!_impl) {
+    return 0;
+  }
+  struct stat st;
+  if (stat(_impl->_hostPath.c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_mtime;
+}
+
+void File::close() {
+  if (_impl) {
+    _impl->close();
+    _impl.reset();
+  }
+}
+
+File::operator bool() const {
+  return _impl && (_impl->_file != NULL || _impl->_dir != NULL);
+}
+
+const char * File::name() const {
+  return (_impl ? _impl->_name.c_str() : NULL);
+}
+
+bool File::isDirectory() {
+  return _impl && _impl->_dir != NULL;
+}
+
+File File::openNextFile(const char * mode) {
+  if (!_impl || _impl->_dir == NULL) {
+    return File();
+  }
+  struct dirent * entry;
+  while ((entry = readdir(_impl->_dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    std::string name = _impl->_name + (_impl->_name == "/" ? "" : "/") + entry->d_name;
+    std::string hostPath = _impl->_hostPath + "/" + entry->d_name;
+    struct stat st;
+    if (stat(hostPath.c_str(), &st) != 0) {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      DIR * dir = opendir(hostPath.c_str());
+      if (dir != NULL) {
+        return File(std::make_shared<FileImpl>(name, hostPath, (FILE*)NULL, dir));
+      }
+    } else {
+      FILE * file = fopen(hostPath.c_str(), mode);
+      if (file != NULL) {
+        return File(std::make_shared<FileImpl>(name, hostPath, file, (DIR*)NULL));
+      }
+    }
+  }
+  return File();
+}
+
+void File::rewindDirectory() {
+  if (_impl && _impl->_dir != NULL) {
+    rewinddir(_impl->_dir);
+  }
+}
+
+FS::FS(const char * rootEnvironmentVariable, const char * defaultRoot):
+  _rootEnvironmentVariable(rootEnvironmentVariable),
+  _defaultRoot(defaultRoot) {
+
+}
+
+/**
+ * Maps a path of the sketch to the host. Paths that try to leave the root directory are rejected
+ * by returning an empty string.
+ */
+std::string FS::hostPath(const char * path) {
+  if (path == NULL || path[0] != '/' || strstr(path, "/..") != NULL) {
+    return std::string();
+  }
+  const char * root = getenv(_rootEnvironmentVariable);
+  std::string hostPath = (root != NULL && root[0] != '\0') ? root : _defaultRoot;
+  if (strcmp(path, "/") != 0) {
+    hostPath += path;
+  }
+  return hostPath;
+}
+
+/**
+ * Checks that the root directory exists. Creates it if create is true.
+ */
+bool FS::mountRoot(bool create) {
+  std::string root = hostPath("/");
+  struct stat st;
+  if (stat(root.c_str(), &st) == 0) {
+    return S_ISDIR(st.st_mode);
+  }
+  return create && ::mkdir(root.c_str(), 0755) == 0;
+}
+
+File FS::open(const char * path, const char * mode) {
+  std::string host = hostPath(path);
+  if (host.empty()) {
+    return File();
+  }
+  struct stat st;
+  if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    DIR * dir = opendir(host.c_str());
+    if (dir == NULL) {
+      return File();
+    }
+    return File(std::make_shared<FileImpl>(path, host, (FILE*)NULL, dir));
+  }
+  // The binary flag makes sure that nothing is converted
+  std::string fileMode = std::string(mode) + "b";
+  FILE * file = fopen(host.c_str(), fileMode.c_str());
+  if (file == NULL) {
+    return File();
+  }
+  return File(std::make_shared<FileImpl>(path, host, file, (DIR*)NULL));
+}
+
+bool FS::exists(const char * path) {
+  std::string host = hostPath(path);
+  struct stat st;
+  return !host.empty() && stat(host.c_str(), &st) == 0;
+}
+
+bool FS::remove(const char * path) {
+  std::string host = hostPath(path);
+  return !host.empty() && unlink(host.c_str()) == 0;
+}
+
+bool FS::rename(const char * pathFrom, const char * pathTo) {
+  std::string hostFrom = hostPath(pathFrom);
+  std::string hostTo = hostPath(pathTo);
+  return !hostFrom.empty() && !hostTo.empty() && ::rename(hostFrom.c_str(), hostTo.c_str()) == 0;
+}
+
+bool FS::mkdir(const char * path) {
+  std::string host = hostPath(path);
+  return !host.empty() && ::mkdir(host.c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char * path) {
+  std::string host = hostPath(path);
+  return !host.empty() && ::rmdir(host.c_str()) == 0;
+}
+
+SPIFFSFS::SPIFFSFS():
+  FS("HTTPS_HOST_FS_ROOT", "data") {
+
+}
+
+/**
+ * An empty directory corresponds to a freshly formatted partition, so the root directory is
+ * created if it does not exist yet.
+ */
+bool SPIFFSFS::begin(bool formatOnFail, const char * basePath, uint8_t maxOpenFiles) {
+  return mountRoot(true);
+}
+
+/**
+ * Formatting is not supported on the host, as it would delete the directory's content
+ */
+bool SPIFFSFS::format() {
+  return false;
+}
+
+size_t SPIFFSFS::totalBytes() {
+  return 0;
+}
+
+size_t SPIFFSFS::usedBytes() {
+  return 0;
+}
+
+} /* namespace fs */
+
+fs::SPIFFSFS SPIFFS;
@@ -0,0 +1,45 @@
+#include <mbedtls/base64.h>
+
+#include <openssl/evp.h>
+#include <string.h>
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen) {
+  size_t n = 4 * ((slen + 2) / 3);
+  if (dst == NULL || dlen < n + 1) {
+    // Like mbedTLS, report the required size including the terminating null
+    *olen = n + 1;
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  }
+  EVP_EncodeBlock(dst, src, slen);
+  *olen = n;
+  return 0;
+}
+
+int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen) {
+  if (slen % 4 != 0) {
+    return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+  }
+  size_t padding = 0;
+  if (slen > 0 && src[slen - 1] == '=') padding++;
+  if (slen > 1 && src[slen - 2] == '=') padding++;
+  size_t n = (slen / 4) * 3 - padding;
+  if (dst == NULL || dlen < n) {
+    *olen = n;
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  }
+  if (slen == 0) {
+    *olen = 0;
+    return 0;
+  }
+  // EVP_DecodeBlock writes the padding bytes too
+  unsigned char * buffer = new unsigned char[(slen / 4) * 3];
+  int res = EVP_DecodeBlock(buffer, src, slen);
+  if (res < 0) {
+    delete[] buffer;
+    return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+  }
+  memcpy(dst, buffer, n);
+  delete[] buffer;
+  *olen = n;
+  return 0;
+}
@@ -0,0 +1,16 @@
+#include <Arduino.h>
+
+/**
+ * Entry point for sketches on the host: Runs setup() once and then loop() forever, like the
+ * Arduino core does on the ESP32.
+ */
+int main(int argc, char ** argv) {
+  // Log messages should appear immediately, also if stdout is redirected
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  setup();
+  while(true) {
+    loop();
+  }
+  return 0;
+}
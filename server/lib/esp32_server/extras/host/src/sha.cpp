@@ -0,0 +1,21 @@
+#include <esp32/sha.h>
+
+#include <openssl/evp.h>
+
+void esp_sha(esp_sha_type type, const unsigned char *input, size_t ilen, unsigned char *output) {
+  const EVP_MD * md;
+  switch(type) {
+  case SHA2_256:
+    md = EVP_sha256();
+    break;
+  case SHA2_384:
+    md = EVP_sha384();
+    break;
+  case SHA2_512:
+    md = EVP_sha512();
+    break;
+  default:
+    md = EVP_sha1();
+  }
+  EVP_Digest(input, ilen, output, NULL, md, NULL);
+}
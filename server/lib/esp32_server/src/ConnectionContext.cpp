@@ -10,6 +10,62 @@ ConnectionContext::~ConnectionContext() {
 	
 }
 
+/**
+ * Returns true if the connection will be reused for further requests after the current one
+ */
+bool ConnectionContext::isKeepAlive() {
+  return false;
+}
+
+/**
+ * Returns true if the response may be sent with Transfer-Encoding: chunked, which requires
+ * a keep-alive connection and a client that speaks HTTP/1.1
+ */
+bool ConnectionContext::isChunkedAllowed() {
+  return false;
+}
+
+/**
+ * Returns the size up to which a response may grow its cache before it is streamed. The default
+ * is the initial size, getCacheSize().
+ */
+size_t ConnectionContext::getMaxCacheSize() {
+  return getCacheSize();
+}
+
+/**
+ * Provides a buffer of at least minSize bytes for a response, and its actual size in size. The
+ * buffer must be passed to releaseResponseBuffer() afterwards.
+ */
+byte * ConnectionContext::acquireResponseBuffer(size_t minSize, size_t * size) {
+  *size = minSize;
+  return new byte[minSize];
+}
+
+void ConnectionContext::releaseResponseBuffer(byte * buffer, size_t size) {
+  delete[] buffer;
+}
+
+/**
+ * Writes several blocks of data, which are sent with as few writes to the socket as possible.
+ *
+ * Returns the number of bytes written. The default implementation calls writeBuffer() for each
+ * block.
+ */
+size_t ConnectionContext::writeBuffers(const ConnectionBufferSegment * segments, size_t count) {
+  size_t written = 0;
+  for(size_t i = 0; i < count; i++) {
+    if (segments[i].length > 0) {
+      size_t rc = writeBuffer((byte*)segments[i].data, segments[i].length);
+      if (rc != segments[i].length) {
+        break;
+      }
+      written += rc;
+    }
+  }
+  return written;
+}
+
 void ConnectionContext::setWebsocketHandler(WebsocketHandler *wsHandler) {
   _wsHandler = wsHandler;
 }
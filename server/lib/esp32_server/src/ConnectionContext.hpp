@@ -12,6 +12,14 @@ namespace httpsserver {
 
 class WebsocketHandler;
 
+/**
+ * \brief A block of data for ConnectionContext::writeBuffers()
+ */
+struct ConnectionBufferSegment {
+  const byte * data;
+  size_t length;
+};
+
 /**
  * \brief Internal class to handle the state of a connection
  */
@@ -23,13 +31,22 @@ public:
   virtual void signalRequestError() = 0;
   virtual void signalClientClose() = 0;
   virtual size_t getCacheSize() = 0;
+  virtual size_t getMaxCacheSize();
+  virtual byte * acquireResponseBuffer(size_t minSize, size_t * size);
+  virtual void releaseResponseBuffer(byte * buffer, size_t size);
 
   virtual size_t readBuffer(byte* buffer, size_t length) = 0;
+  virtual size_t peekBuffer(const byte ** data) = 0;
+  virtual void skipBuffer(size_t length) = 0;
   virtual size_t pendingBufferSize() = 0;
+  virtual bool isInputClosed() = 0;
 
   virtual size_t writeBuffer(byte* buffer, size_t length) = 0;
+  virtual size_t writeBuffers(const ConnectionBufferSegment * segments, size_t count);
 
   virtual bool isSecure() = 0;
+  virtual bool isKeepAlive();
+  virtual bool isChunkedAllowed();
   virtual void setWebsocketHandler(WebsocketHandler *wsHandler);
   virtual IPAddress getClientIP() = 0;
 
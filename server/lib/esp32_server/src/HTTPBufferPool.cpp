@@ -0,0 +1,102 @@
+#include "HTTPBufferPool.hpp"
+
+namespace httpsserver {
+
+HTTPBufferPool::HTTPBufferPool(size_t minSize, size_t maxSize, uint8_t depth):
+  _depth(depth),
+  _hits(0),
+  _misses(0),
+  _pooledBytes(0) {
+  if (maxSize < minSize) {
+    maxSize = minSize;
+  }
+  _classCount = 0;
+  size_t size = minSize;
+  while (size < maxSize && _classCount < MAX_CLASSES - 1) {
+    _classSizes[_classCount++] = size;
+    size *= 2;
+  }
+  _classSizes[_classCount++] = maxSize;
+
+  _free = new byte*[_classCount * _depth];
+  for(uint8_t i = 0; i < _classCount; i++) {
+    _freeCount[i] = 0;
+  }
+}
+
+HTTPBufferPool::~HTTPBufferPool() {
+  for(uint8_t i = 0; i < _classCount; i++) {
+    for(uint8_t j = 0; j < _freeCount[i]; j++) {
+      delete[] _free[i * _depth + j];
+    }
+  }
+  delete[] _free;
+}
+
+/**
+ * Returns a buffer of at least minSize bytes, and its actual size in size.
+ *
+ * If minSize is larger than the largest class, a buffer of exactly that size is allocated, which
+ * is not kept by release().
+ */
+byte * HTTPBufferPool::acquire(size_t minSize, size_t * size) {
+  int idx = findClass(minSize);
+  if (idx < 0) {
+    _misses++;
+    *size = minSize;
+    return new byte[minSize];
+  }
+  *size = _classSizes[idx];
+  if (_freeCount[idx] > 0) {
+    _hits++;
+    _pooledBytes -= _classSizes[idx];
+    return _free[idx * _depth + --_freeCount[idx]];
+  }
+  _misses++;
+  return new byte[_classSizes[idx]];
+}
+
+/**
+ * Returns a buffer to the pool. size must be the value that acquire() has returned for it.
+ */
+void HTTPBufferPool::release(byte * buffer, size_t size) {
+  if (buffer == NULL) {
+    return;
+  }
+  int idx = findClass(size);
+  if (idx >= 0 && _classSizes[idx] == size && _freeCount[idx] < _depth) {
+    _free[idx * _depth + _freeCount[idx]++] = buffer;
+    _pooledBytes += size;
+  } else {
+    delete[] buffer;
+  }
+}
+
+/**
+ * Returns the size of the largest class
+ */
+size_t HTTPBufferPool::getMaxSize() {
+  return _classSizes[_classCount - 1];
+}
+
+HTTPBufferPoolStats HTTPBufferPool::getStats() {
+  HTTPBufferPoolStats stats;
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.pooledBytes = _pooledBytes;
+  return stats;
+}
+
+/**
+ * Returns the index of the smallest class with buffers of at least size bytes, or -1
+ */
+int HTTPBufferPool::findClass(size_t size) {
+  for(uint8_t i = 0; i < _classCount; i++) {
+    if (_classSizes[i] >= size) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+} /* namespace httpsserver */
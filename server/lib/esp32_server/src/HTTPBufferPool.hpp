@@ -0,0 +1,72 @@
+#ifndef SRC_HTTPBUFFERPOOL_HPP_
+#define SRC_HTTPBUFFERPOOL_HPP_
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "HTTPSServerConstants.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Statistics of an HTTPBufferPool, see HTTPServer::getWorkerStats()
+ */
+struct HTTPBufferPoolStats {
+  /** Number of buffers that have been taken from the pool */
+  uint32_t hits;
+  /** Number of buffers that had to be allocated because the pool had none of the requested size */
+  uint32_t misses;
+  /** Number of bytes in buffers that are currently kept by the pool */
+  uint32_t pooledBytes;
+};
+
+/**
+ * \brief Keeps response buffers for reuse
+ *
+ * The buffers are organized in size classes. The smallest class has the size
+ * passed as minSize, each further class has twice the size of the previous one,
+ * and the largest one has maxSize. A request for a buffer is served with the
+ * smallest class that is large enough, so buffers can be reused for responses
+ * of different sizes.
+ *
+ * For each class, up to depth buffers are kept when they are released. Others
+ * are freed.
+ *
+ * The pool is not thread-safe. Each HTTPWorker owns a pool for the connections
+ * it processes. Only getStats() may be called from other threads.
+ */
+class HTTPBufferPool {
+public:
+  HTTPBufferPool(size_t minSize, size_t maxSize, uint8_t depth = HTTPS_BUFFER_POOL_DEPTH);
+  virtual ~HTTPBufferPool();
+
+  byte * acquire(size_t minSize, size_t * size);
+  void release(byte * buffer, size_t size);
+
+  size_t getMaxSize();
+  HTTPBufferPoolStats getStats();
+
+private:
+  static const uint8_t MAX_CLASSES = 8;
+
+  int findClass(size_t size);
+
+  // Size of the buffers of each class, in ascending order
+  size_t _classSizes[MAX_CLASSES];
+  uint8_t _classCount;
+
+  // Free buffers, depth entries per class
+  byte ** _free;
+  uint8_t _freeCount[MAX_CLASSES];
+  const uint8_t _depth;
+
+  // Statistics, may be read from other threads
+  std::atomic<uint32_t> _hits;
+  std::atomic<uint32_t> _misses;
+  std::atomic<uint32_t> _pooledBytes;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPBUFFERPOOL_HPP_ */
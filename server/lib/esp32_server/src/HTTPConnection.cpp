@@ -4,45 +4,146 @@ void handleHandshake(int status, const char* msg);
 
 namespace httpsserver {
 
-HTTPConnection::HTTPConnection(ResourceResolver * resResolver):
+HTTPConnection::HTTPConnection(ResourceResolver * resResolver, size_t receiveBufferSize):
+  _receiveBufferSize(receiveBufferSize),
   _resResolver(resResolver) {
+  _receiveBuffer = new char[receiveBufferSize];
+  _requestHead.reserve(HTTPS_REQUEST_MAX_REQUEST_LENGTH + HTTPS_CONNECTION_DATA_CHUNK_SIZE);
+  _httpHeaders = NULL;
+  _responseHeaders = NULL;
+  _wsHandler = nullptr;
+  _allocationCount = 0;
+  _responseCount = 0;
+  _writeCount = 0;
+  _recordCount = 0;
+  _pipelineDepth = HTTPS_PIPELINE_MAX_DEPTH;
+  _bufferPool = NULL;
+  _errorResponses = NULL;
+  _handlerCache = NULL;
+  reset();
+}
+
+HTTPConnection::~HTTPConnection() {
+  // Close the socket
+  closeConnection();
+
+  if (_httpHeaders != NULL) {
+    delete _httpHeaders;
+    _httpHeaders = NULL;
+  }
+  if (_responseHeaders != NULL) {
+    delete _responseHeaders;
+    _responseHeaders = NULL;
+  }
+
+  delete[] _receiveBuffer;
+}
+
+/**
+ * Resets the connection to STATE_UNDEFINED, so that the object can be reused for the next socket.
+ *
+ * Buffers and header storage are kept. Must only be called for a connection that is closed (or has
+ * never been initialized).
+ */
+void HTTPConnection::reset() {
   _socket = -1;
   _addrLen = 0;
 
-  _bufferProcessed = 0;
-  _bufferUnusedIdx = 0;
+  _bufferReadIdx = 0;
+  _bufferFill = 0;
 
   _connectionState = STATE_UNDEFINED;
   _clientState = CSTATE_UNDEFINED;
-  _httpHeaders = NULL;
   _defaultHeaders = NULL;
   _isKeepAlive = false;
   _lastTransmissionTS = millis();
   _shutdownTS = 0;
-  _wsHandler = nullptr;
+  _handshakeTS = 0;
+  _readReadyKnown = false;
+  _readReady = false;
+
+  _requestHead.clear();
+  _parserLine.start = 0;
+  _parserLine.length = 0;
+  _parserLine.parsingFinished = false;
+  _httpMethod.clear();
+  _httpMethodId = METHOD_UNKNOWN;
+  _httpResource.clear();
+  _isHTTP11 = false;
+  if (_httpHeaders != NULL) {
+    _httpHeaders->clearAll();
+  }
+  if (_responseHeaders != NULL) {
+    _responseHeaders->clearAll();
+  }
+
+  if (_wsHandler != nullptr) {
+    delete _wsHandler;
+    _wsHandler = nullptr;
+  }
 }
 
-HTTPConnection::~HTTPConnection() {
-  // Close the socket
-  closeConnection();
+/**
+ * Returns the number of heap allocations this object did for its own storage
+ */
+uint32_t HTTPConnection::getAllocationCount() {
+  return _allocationCount;
+}
+
+/**
+ * Returns the number of responses this object has sent
+ */
+uint32_t HTTPConnection::getResponseCount() {
+  return _responseCount;
+}
+
+/**
+ * Returns the number of writes to the socket this object has done, for HTTPS the number of calls
+ * to SSL_write()
+ */
+uint32_t HTTPConnection::getWriteCount() {
+  return _writeCount;
+}
+
+/**
+ * Returns the number of TLS records this object has sent, 0 for plain HTTP
+ */
+uint32_t HTTPConnection::getRecordCount() {
+  return _recordCount;
 }
 
 /**
  * Initializes the connection from a server socket.
  *
  * The call WILL BLOCK if accept(serverSocketID) blocks. So use select() to check for that in advance.
+ *
+ * If the socket has already been accepted and passed with setAcceptedSocket(), that socket is used instead.
  */
 int HTTPConnection::initialize(int serverSocketID, HTTPHeaders *defaultHeaders) {
   if (_connectionState == STATE_UNDEFINED) {
     _defaultHeaders = defaultHeaders;
-    _addrLen = sizeof(_sockAddr);
-    _socket = accept(serverSocketID, (struct sockaddr * )&_sockAddr, &_addrLen);
+    if (_socket < 0) {
+      _addrLen = sizeof(_sockAddr);
+      _socket = accept(serverSocketID, (struct sockaddr * )&_sockAddr, &_addrLen);
+    }
 
     // Build up SSL Connection context if the socket has been created successfully
     if (_socket >= 0) {
       HTTPS_LOGI("New connection. Socket FID=%d", _socket);
       _connectionState = STATE_INITIAL;
-      _httpHeaders = new HTTPHeaders();
+      // Responses are combined into as few writes as possible, so Nagle's algorithm would only
+      // delay their last segment until the client acknowledges the previous ones
+      int noDelay = 1;
+      setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      // The header storage is kept if the connection object is reused
+      if (_httpHeaders == NULL) {
+        _httpHeaders = new HTTPHeaders();
+        _allocationCount++;
+      }
+      if (_responseHeaders == NULL) {
+        _responseHeaders = new HTTPHeaders();
+        _allocationCount++;
+      }
       refreshTimeout();
       return _socket;
     }
@@ -61,6 +162,44 @@ int HTTPConnection::initialize(int serverSocketID, HTTPHeaders *defaultHeaders)
   return -1;
 }
 
+/**
+ * Passes a socket that has already been accepted by the server. Must be called before initialize().
+ */
+void HTTPConnection::setAcceptedSocket(int socket, const struct sockaddr * addr, socklen_t addrLen) {
+  if (_connectionState == STATE_UNDEFINED) {
+    _socket = socket;
+    _addrLen = std::min(addrLen, (socklen_t)sizeof(_sockAddr));
+    memcpy(&_sockAddr, addr, _addrLen);
+  }
+}
+
+/**
+ * Sets the maximum number of pipelined requests that are processed in one call to loop()
+ */
+void HTTPConnection::setPipelineDepth(uint8_t pipelineDepth) {
+  _pipelineDepth = pipelineDepth;
+}
+
+/**
+ * Sets the pool that response buffers are taken from. It must only be used by the thread that
+ * processes this connection.
+ */
+void HTTPConnection::setBufferPool(HTTPBufferPool * bufferPool) {
+  _bufferPool = bufferPool;
+}
+
+void HTTPConnection::setErrorResponses(HTTPErrorResponses * errorResponses) {
+  _errorResponses = errorResponses;
+}
+
+/**
+ * Sets the cache for the responses of nodes with ResourceNode::setHandlerCacheTTL(). It is shared
+ * with other connections.
+ */
+void HTTPConnection::setHandlerCache(HTTPHandlerCache * handlerCache) {
+  _handlerCache = handlerCache;
+}
+
 /**
  * Handle the HTTP request with a status code and a messasge string.
  */
@@ -88,6 +227,13 @@ bool HTTPConnection::isTimeoutExceeded() {
   return _lastTransmissionTS + HTTPS_CONNECTION_TIMEOUT < millis();
 }
 
+/**
+ * True if the TLS handshake has not been completed within HTTPS_HANDSHAKE_TIMEOUT milliseconds.
+ */
+bool HTTPConnection::isHandshakeTimeoutExceeded() {
+  return _handshakeTS + HTTPS_HANDSHAKE_TIMEOUT < millis();
+}
+
 /**
  * Resets the timeout to allow again the full HTTPS_CONNECTION_TIMEOUT milliseconds
  */
@@ -113,6 +259,87 @@ bool HTTPConnection::isSecure() {
   return false;
 }
 
+bool HTTPConnection::isKeepAlive() {
+  return _isKeepAlive;
+}
+
+bool HTTPConnection::isChunkedAllowed() {
+  return _isKeepAlive && _isHTTP11;
+}
+
+/**
+ * Returns the socket file descriptor of this connection or -1 if there is none
+ */
+int HTTPConnection::getSocket() {
+  return _socket;
+}
+
+/**
+ * Returns true if data has been received but not been processed yet. This includes
+ * data in the receive buffer as well as data that is buffered by the TLS layer.
+ *
+ * A connection with pending data has to be processed even if the socket is not readable.
+ */
+bool HTTPConnection::hasPendingData() {
+  return (_bufferFill > 0) || (pendingByteCount() > 0);
+}
+
+/**
+ * Returns true if the connection has to be processed in the next loop pass, regardless
+ * of whether there is new data on the socket or not. This is the case for states that
+ * do not wait for input (the request is to be handled, the connection is closing, ...)
+ * and for connections that need to be checked for timeouts.
+ */
+bool HTTPConnection::needsProcessing() {
+  if (isClosed()) {
+    return false;
+  }
+  if (_clientState == CSTATE_CLOSED || isTimeoutExceeded()) {
+    return true;
+  }
+  switch(_connectionState) {
+  case STATE_HANDSHAKE:
+    return isHandshakeTimeoutExceeded();
+  case STATE_HEADERS_FINISHED:
+  case STATE_BODY_FINISHED:
+  case STATE_CLOSING:
+    return true;
+  case STATE_WEBSOCKET:
+    return _wsHandler != nullptr && _wsHandler->closed();
+  default:
+    return false;
+  }
+}
+
+/**
+ * Returns true if the connection cannot progress until the socket becomes writable.
+ *
+ * The plain connection always writes blocking, so this is only used by the handshake of HTTPSConnection.
+ */
+bool HTTPConnection::isWaitingForWrite() {
+  return false;
+}
+
+/**
+ * Continues the connection setup for protocols that require a handshake before the
+ * first request can be read.
+ *
+ * Returns true if the handshake is complete. The plain connection has no handshake.
+ */
+bool HTTPConnection::continueHandshake() {
+  return true;
+}
+
+/**
+ * Used by the server to pass the readiness of the socket that it has determined for all
+ * connections at once. The next call to canReadData() will use this value instead of
+ * querying the socket again. Any further call will fall back to select().
+ */
+void HTTPConnection::setReadReady(bool readReady) {
+  _readReadyKnown = true;
+  _readReady = readReady;
+}
+
 void HTTPConnection::closeConnection() {
   // TODO: Call an event handler here, maybe?
 
@@ -141,9 +368,8 @@ void HTTPConnection::closeConnection() {
   }
 
   if (_httpHeaders != NULL) {
-    HTTPS_LOGD("Free headers");
-    delete _httpHeaders;
-    _httpHeaders = NULL;
+    HTTPS_LOGD("Clear headers");
+    _httpHeaders->clearAll();
   }
 
   if (_wsHandler != nullptr) {
@@ -154,36 +380,18 @@ void HTTPConnection::closeConnection() {
 }
 
 /**
- * This method will try to fill up the buffer with data from
+ * This method will try to fill up the buffer with data from the socket
  */
 int HTTPConnection::updateBuffer() {
   if (!isClosed()) {
 
-    // If there is buffer data that has been marked as processed.
-    // Some example is shown here:
-    //
-    // Previous configuration:
-    // GET / HTTP/1.1\\Host: test\\Foo: bar\\\\[some uninitialized memory]
-    //                 ^ processed             ^ unusedIdx
-    //
-    // New configuration after shifting:
-    // Host: test\\Foo: bar\\\\[some uninitialized memory]
-    // ^ processed             ^ unusedIdx
-    if (_bufferProcessed > 0) {
-      for(int i = 0; i < HTTPS_CONNECTION_DATA_CHUNK_SIZE; i++) {
-        int copyFrom = i + _bufferProcessed;
-        if (copyFrom < _bufferUnusedIdx) {
-          _receiveBuffer[i] = _receiveBuffer[copyFrom];
-        } else {
-          break;
-        }
-      }
-      _bufferUnusedIdx -= _bufferProcessed;
-      _bufferProcessed = 0;
-
-    }
+    // The buffer is circular, so data is appended after the unprocessed data without moving it.
+    // If the free space wraps around the end of the buffer, only the part up to the end is filled
+    // during this call.
+    char * freeSpace;
+    size_t freeLength = bufferWriteSpan(&freeSpace);
 
-    if (_bufferUnusedIdx < HTTPS_CONNECTION_DATA_CHUNK_SIZE) {
+    if (freeLength > 0) {
       if (canReadData()) {
 
         HTTPS_LOGD("Data on Socket FID=%d", _socket);
@@ -194,15 +402,10 @@ int HTTPConnection::updateBuffer() {
         // > 0 : Length of the data that has been read
         // < 0 : Error
         // = 0 : Connection closed
-        readReturnCode = readBytesToBuffer(
-            // Only after the part of the buffer that has not been processed yet
-            (byte*)(_receiveBuffer + sizeof(char) * _bufferUnusedIdx),
-            // Only append up to the end of the buffer
-            HTTPS_CONNECTION_DATA_CHUNK_SIZE - _bufferUnusedIdx
-        );
+        readReturnCode = readBytesToBuffer((byte*)freeSpace, freeLength);
 
         if (readReturnCode > 0) {
-          _bufferUnusedIdx += readReturnCode;
+          _bufferFill += readReturnCode;
           refreshTimeout();
           return readReturnCode;
 
@@ -227,7 +430,54 @@ int HTTPConnection::updateBuffer() {
   return 0;
 }
 
+/**
+ * Returns the length of the contiguous block of unprocessed data at the start of the receive buffer
+ * and stores its address in data. If the data wraps around, the remainder can be accessed after calling
+ * bufferConsume() with the returned length.
+ */
+size_t HTTPConnection::bufferReadSpan(char ** data) {
+  *data = _receiveBuffer + _bufferReadIdx;
+  return std::min(_bufferFill, _receiveBufferSize - _bufferReadIdx);
+}
+
+/**
+ * Returns the length of the contiguous block of free space after the unprocessed data and stores its
+ * address in data.
+ */
+size_t HTTPConnection::bufferWriteSpan(char ** data) {
+  if (_bufferFill == 0) {
+    // Start at the beginning again if the buffer is empty, so we get the largest block possible
+    _bufferReadIdx = 0;
+  }
+  size_t writeIdx = _bufferReadIdx + _bufferFill;
+  if (writeIdx >= _receiveBufferSize) {
+    // The data already wraps around, the free space is between its end and _bufferReadIdx
+    writeIdx -= _receiveBufferSize;
+    *data = _receiveBuffer + writeIdx;
+    return _bufferReadIdx - writeIdx;
+  }
+  *data = _receiveBuffer + writeIdx;
+  return _receiveBufferSize - writeIdx;
+}
+
+/**
+ * Marks length bytes at the start of the unprocessed data as processed
+ */
+void HTTPConnection::bufferConsume(size_t length) {
+  _bufferFill -= length;
+  _bufferReadIdx += length;
+  if (_bufferReadIdx >= _receiveBufferSize) {
+    _bufferReadIdx -= _receiveBufferSize;
+  }
+}
+
 bool HTTPConnection::canReadData() {
+  // If the server already checked the socket during this loop pass, use that result once
+  if (_readReadyKnown) {
+    _readReadyKnown = false;
+    return _readReady;
+  }
+
   fd_set sockfds;
   FD_ZERO( &sockfds );
   FD_SET(_socket, &sockfds);
@@ -247,24 +497,53 @@ bool HTTPConnection::canReadData() {
 
 size_t HTTPConnection::readBuffer(byte* buffer, size_t length) {
   updateBuffer();
-  size_t bufferSize = _bufferUnusedIdx - _bufferProcessed;
 
-  if (length > bufferSize) {
-    length = bufferSize;
+  // Copy up to two contiguous blocks (if the data wraps around the end of the buffer)
+  size_t bytesRead = 0;
+  while(bytesRead < length && _bufferFill > 0) {
+    char * data;
+    size_t spanLength = std::min(bufferReadSpan(&data), length - bytesRead);
+    memcpy(buffer + bytesRead, data, spanLength);
+    bufferConsume(spanLength);
+    bytesRead += spanLength;
   }
 
-  // Write until length is reached (either by param of by empty buffer
-  for(int i = 0; i < length; i++) {
-    buffer[i] = _receiveBuffer[_bufferProcessed++];
+  return bytesRead;
+}
+
+/**
+ * Returns the contiguous block of received data that has not been read yet, without consuming it.
+ * The socket is only read if no data is left. Call skipBuffer() for the bytes that have been processed.
+ */
+size_t HTTPConnection::peekBuffer(const byte ** data) {
+  if (_bufferFill == 0) {
+    updateBuffer();
   }
+  char * span;
+  size_t spanLength = bufferReadSpan(&span);
+  *data = (const byte*)span;
+  return spanLength;
+}
 
-  return length;
+/**
+ * Consumes length bytes of the block returned by peekBuffer()
+ */
+void HTTPConnection::skipBuffer(size_t length) {
+  bufferConsume(length);
+}
+
+/**
+ * True if no further data of the request will arrive: The client has closed the connection, the
+ * connection has been closed, or it has timed out.
+ */
+bool HTTPConnection::isInputClosed() {
+  return _clientState == CSTATE_CLOSED || isClosed() || isTimeoutExceeded();
 }
 
 size_t HTTPConnection::pendingBufferSize() {
   updateBuffer();
 
-  return _bufferUnusedIdx - _bufferProcessed + pendingByteCount();
+  return _bufferFill + pendingByteCount();
 }
 
 size_t HTTPConnection::pendingByteCount() {
@@ -272,61 +551,117 @@ size_t HTTPConnection::pendingByteCount() {
 }
 
 size_t HTTPConnection::writeBuffer(byte* buffer, size_t length) {
+  _writeCount++;
   return send(_socket, buffer, length, 0);
 }
 
+/**
+ * Sends all blocks with a single sendmsg()
+ */
+size_t HTTPConnection::writeBuffers(const ConnectionBufferSegment * segments, size_t count) {
+  const size_t maxSegments = 8;
+  struct iovec iov[maxSegments];
+  if (count > maxSegments) {
+    return ConnectionContext::writeBuffers(segments, count);
+  }
+  for(size_t i = 0; i < count; i++) {
+    iov[i].iov_base = (void*)segments[i].data;
+    iov[i].iov_len = segments[i].length;
+  }
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = count;
+  _writeCount++;
+  ssize_t written = sendmsg(_socket, &msg, 0);
+  return written < 0 ? 0 : written;
+}
+
 size_t HTTPConnection::readBytesToBuffer(byte* buffer, size_t length) {
   return recv(_socket, buffer, length, MSG_WAITALL | MSG_DONTWAIT);
 }
 
+/**
+ * Sends an error response and closes the connection.
+ *
+ * The response is taken from the server's HTTPErrorResponses, so it may have a custom body. For
+ * codes without a prebuilt response, it is serialized from code and reason.
+ */
 void HTTPConnection::raiseError(uint16_t code, std::string reason) {
   _connectionState = STATE_ERROR;
-  std::string sCode = intToString(code);
-
-  char headers[] = "\r\nConnection: close\r\nContent-Type: text/plain;charset=utf8\r\n\r\n";
-  writeBuffer((byte*)"HTTP/1.1 ", 9);
-  writeBuffer((byte*)sCode.c_str(), sCode.length());
-  writeBuffer((byte*)" ", 1);
-  writeBuffer((byte*)(reason.c_str()), reason.length());
-  writeBuffer((byte*)headers, strlen(headers));
-  writeBuffer((byte*)sCode.c_str(), sCode.length());
-  writeBuffer((byte*)" ", 1);
-  writeBuffer((byte*)(reason.c_str()), reason.length());
+
+  // The response is sent with a single write, usually from the prebuilt table
+  HTTPErrorResponses builtinResponses;
+  HTTPErrorResponses * responses = (_errorResponses != NULL ? _errorResponses : &builtinResponses);
+  const byte * data;
+  size_t length;
+  if (responses->get(code, &data, &length)) {
+    writeBuffer((byte*)data, length);
+  } else {
+    std::string response;
+    HTTPErrorResponses::serialize(response, code, reason, intToString(code) + " " + reason, "text/plain;charset=utf8");
+    writeBuffer((byte*)response.data(), response.length());
+  }
   closeConnection();
 }
 
-void HTTPConnection::readLine(int lengthLimit) {
-  while(_bufferProcessed < _bufferUnusedIdx) {
-    char newChar = _receiveBuffer[_bufferProcessed];
-
-    if ( newChar == '\r') {
-      // Look ahead for \n (if not possible, wait for next round
-      if (_bufferProcessed+1 < _bufferUnusedIdx) {
-        if (_receiveBuffer[_bufferProcessed+1] == '\n') {
-          _bufferProcessed += 2;
-          _parserLine.parsingFinished = true;
-          return;
-        } else {
-          // Line has not been terminated by \r\n
-          HTTPS_LOGW("Line without \\r\\n (got only \\r). FID=%d", _socket);
-          raiseError(400, "Bad Request");
-          return;
-        }
-      }
-    } else {
-      _parserLine.text += newChar;
-      _bufferProcessed += 1;
+/**
+ * Reads the next line (terminated by \r\n) from the receive buffer into _requestHead.
+ *
+ * The buffer is searched with memchr() and everything up to the line break is copied in one
+ * block, so the request line and the headers are not processed character by character. If the
+ * line is complete, _parserLine.parsingFinished is set and _parserLine describes where the line
+ * is located in _requestHead.
+ */
+void HTTPConnection::readLine(size_t lengthLimit) {
+  while(_bufferFill > 0) {
+    char * data;
+    size_t spanLength = bufferReadSpan(&data);
+    char * lineEnd = (char*)memchr(data, '\n', spanLength);
+    size_t copyLength = (lineEnd == NULL ? spanLength : lineEnd - data);
+
+    // Check that the max request string size is not exceeded. A trailing \r does not count, as it
+    // belongs to the line break.
+    size_t lineLength = _requestHead.length() - _parserLine.start + copyLength;
+    char lastChar = (copyLength > 0 ? data[copyLength - 1] : (lineLength > 0 ? _requestHead.back() : 0));
+    if (lastChar == '\r') {
+      lineLength--;
     }
-
-    // Check that the max request string size is not exceeded
-    if (_parserLine.text.length() > lengthLimit) {
+    if (lineLength > lengthLimit) {
       HTTPS_LOGW("Header length exceeded. FID=%d", _socket);
       raiseError(431, "Request Header Fields Too Large");
       return;
     }
+
+    _requestHead.append(data, copyLength);
+    bufferConsume(lineEnd == NULL ? copyLength : copyLength + 1);
+
+    if (lineEnd != NULL) {
+      const char * line = _requestHead.data() + _parserLine.start;
+      size_t length = _requestHead.length() - _parserLine.start;
+      // The line must be terminated by \r\n, and a \r is not allowed anywhere else
+      if (length == 0 || line[length - 1] != '\r' || memchr(line, '\r', length - 1) != NULL) {
+        HTTPS_LOGW("Line without \\r\\n. FID=%d", _socket);
+        raiseError(400, "Bad Request");
+        return;
+      }
+      _requestHead.pop_back();
+      _parserLine.length = length - 1;
+      _parserLine.parsingFinished = true;
+      return;
+    }
   }
 }
 
+/**
+ * Prepares _parserLine for reading the next line
+ */
+void HTTPConnection::nextLine() {
+  _parserLine.start = _requestHead.length();
+  _parserLine.length = 0;
+  _parserLine.parsingFinished = false;
+}
+
 /**
  * Called by the request to signal that the client has closed the connection
  */
@@ -351,7 +686,46 @@ size_t HTTPConnection::getCacheSize() {
   return (_isKeepAlive ? HTTPS_KEEPALIVE_CACHESIZE : 0);
 }
 
+size_t HTTPConnection::getMaxCacheSize() {
+  if (!_isKeepAlive) {
+    return 0;
+  }
+  return (_bufferPool != NULL ? _bufferPool->getMaxSize() : HTTPS_KEEPALIVE_CACHE_MAXSIZE);
+}
+
+byte * HTTPConnection::acquireResponseBuffer(size_t minSize, size_t * size) {
+  if (_bufferPool != NULL) {
+    return _bufferPool->acquire(minSize, size);
+  }
+  return ConnectionContext::acquireResponseBuffer(minSize, size);
+}
+
+void HTTPConnection::releaseResponseBuffer(byte * buffer, size_t size) {
+  if (_bufferPool != NULL) {
+    _bufferPool->release(buffer, size);
+  } else {
+    ConnectionContext::releaseResponseBuffer(buffer, size);
+  }
+}
+
 void HTTPConnection::loop() {
+  // The handshake has to be finished before any request data can be read
+  if (_connectionState == STATE_HANDSHAKE) {
+    if (isHandshakeTimeoutExceeded()) {
+      HTTPS_LOGI("Handshake timeout. FID=%d", _socket);
+      _connectionState = STATE_ERROR;
+      closeConnection();
+    }
+
+    // The readiness passed by the server has been used up by the handshake, so
+    // it must not be used for reading request data
+    _readReadyKnown = false;
+
+    if (isClosed() || !continueHandshake()) {
+      return;
+    }
+  }
+
   // First, update the buffer
   // newByteCount will contain the number of new bytes that have to be processed
   updateBuffer();
@@ -360,7 +734,7 @@ void HTTPConnection::loop() {
     HTTPS_LOGI("Client closed (FID=%d, cstate=%d)", _socket, _clientState);
   }
 
-  if (_clientState == CSTATE_CLOSED && _bufferProcessed == _bufferUnusedIdx && _connectionState < STATE_HEADERS_FINISHED) {
+  if (_clientState == CSTATE_CLOSED && _bufferFill == 0 && _connectionState < STATE_HEADERS_FINISHED) {
     closeConnection();
   }
 
@@ -369,32 +743,53 @@ void HTTPConnection::loop() {
     closeConnection();
   }
 
-  if (!isError()) {
+  // Requests that have already been received completely are processed right away instead of
+  // waiting for the next pass (pipelining). The responses are sent in order, as each request is
+  // handled completely before the next one is parsed.
+  uint8_t finishedRequests = 0;
+  bool processNextState = true;
+  while (!isError() && processNextState) {
+    int previousState = _connectionState;
+
     // State machine (Reading request, reading headers, ...)
     switch(_connectionState) {
     case STATE_INITIAL: // Read request line
       readLine(HTTPS_REQUEST_MAX_REQUEST_LENGTH);
       if (_parserLine.parsingFinished && !isClosed()) {
+        const char * line = _requestHead.data() + _parserLine.start;
+
         // Find the method
-        size_t spaceAfterMethodIdx = _parserLine.text.find(' ');
-        if (spaceAfterMethodIdx == std::string::npos) {
+        const char * spaceAfterMethod = (const char*)memchr(line, ' ', _parserLine.length);
+        if (spaceAfterMethod == NULL) {
           HTTPS_LOGW("Missing space after method");
           raiseError(400, "Bad Request");
           break;
         }
-        _httpMethod = _parserLine.text.substr(0, spaceAfterMethodIdx);
 
         // Find the resource string:
-        size_t spaceAfterResourceIdx = _parserLine.text.find(' ', spaceAfterMethodIdx + 1);
-        if (spaceAfterResourceIdx == std::string::npos) {
+        const char * resource = spaceAfterMethod + 1;
+        const char * spaceAfterResource = (const char*)memchr(resource, ' ', line + _parserLine.length - resource);
+        if (spaceAfterResource == NULL) {
           HTTPS_LOGW("Missing space after resource");
           raiseError(400, "Bad Request");
           break;
         }
-        _httpResource = _parserLine.text.substr(spaceAfterMethodIdx + 1, spaceAfterResourceIdx - _httpMethod.length() - 1);
 
-        _parserLine.parsingFinished = false;
-        _parserLine.text = "";
+        // assign() keeps the capacity of the strings from the previous request
+        _httpMethod.assign(line, spaceAfterMethod - line);
+        _httpMethodId = identifyMethod(line, spaceAfterMethod - line);
+        _httpResource.assign(resource, spaceAfterResource - resource);
+
+        // The version decides whether the response may use chunked encoding. HTTP/1.0 clients
+        // may still request keep-alive, so it cannot be derived from the Connection header
+        const char * version = spaceAfterResource + 1;
+        size_t versionLength = line + _parserLine.length - version;
+        _isHTTP11 = versionLength == 8 && memcmp(version, "HTTP/1.", 7) == 0 && version[7] >= '1' && version[7] <= '9';
+
+        // The header offsets refer to _requestHead, which is only appended to until the next request
+        _httpHeaders->setRawSource(&_requestHead);
+
+        nextLine();
         HTTPS_LOGI("Request: %s %s (FID=%d)", _httpMethod.c_str(), _httpResource.c_str(), _socket);
         _connectionState = STATE_REQUEST_FINISHED;
       }
@@ -402,66 +797,70 @@ void HTTPConnection::loop() {
       break;
     case STATE_REQUEST_FINISHED: // Read headers
 
-      while (_bufferProcessed < _bufferUnusedIdx && !isClosed()) {
+      while (_bufferFill > 0 && !isClosed()) {
         readLine(HTTPS_REQUEST_MAX_HEADER_LENGTH);
         if (_parserLine.parsingFinished && _connectionState != STATE_ERROR) {
 
-          if (_parserLine.text.empty()) {
+          if (_parserLine.length == 0) {
             HTTPS_LOGD("Headers finished, FID=%d", _socket);
             _connectionState = STATE_HEADERS_FINISHED;
 
             // Break, so that the rest of the body does not get flushed through
-            _parserLine.parsingFinished = false;
-            _parserLine.text = "";
+            nextLine();
             break;
           } else {
-            int idxColon = _parserLine.text.find(':');
-            if ( (idxColon != std::string::npos) && (_parserLine.text[idxColon+1]==' ') ) {
-              _httpHeaders->set(new HTTPHeader(
-                  _parserLine.text.substr(0, idxColon),
-                  _parserLine.text.substr(idxColon+2)
-              ));
-              HTTPS_LOGD("Header: %s = %s (FID=%d)", _parserLine.text.substr(0, idxColon).c_str(), _parserLine.text.substr(idxColon+2).c_str(), _socket);
+            const char * line = _requestHead.data() + _parserLine.start;
+            const char * colon = (const char*)memchr(line, ':', _parserLine.length);
+            size_t idxColon = (colon == NULL ? 0 : colon - line);
+            if ( (colon != NULL) && (idxColon + 1 < _parserLine.length) && (line[idxColon+1]==' ') ) {
+              if (_httpHeaders->getCount() >= HTTPS_REQUEST_MAX_HEADERS) {
+                HTTPS_LOGW("Too many request headers. FID=%d", _socket);
+                raiseError(431, "Request Header Fields Too Large");
+                break;
+              }
+              // Only the location is stored, the HTTPHeader is created when the header is accessed
+              _httpHeaders->addRaw(
+                _parserLine.start, idxColon,
+                _parserLine.start + idxColon + 2, _parserLine.length - idxColon - 2
+              );
+              HTTPS_LOGD("Header: %.*s = %.*s (FID=%d)", (int)idxColon, line,
+                (int)(_parserLine.length - idxColon - 2), colon + 2, _socket);
             } else {
-              HTTPS_LOGW("Malformed request header: %s", _parserLine.text.c_str());
+              HTTPS_LOGW("Malformed request header: %.*s", (int)_parserLine.length, line);
               raiseError(400, "Bad Request");
               break;
             }
           }
 
-          _parserLine.parsingFinished = false;
-          _parserLine.text = "";
+          nextLine();
         }
       }
 
       break;
     case STATE_HEADERS_FINISHED: // Handle body
       {
+        if (!checkTransferEncoding()) {
+          break;
+        }
+
         HTTPS_LOGD("Resolving resource...");
         ResolvedResource resolvedResource;
 
         // Check which kind of node we need (Websocket or regular)
         bool websocketRequested = checkWebsocket();
 
-        _resResolver->resolveNode(_httpMethod, _httpResource, resolvedResource, websocketRequested ? WEBSOCKET : HANDLER_CALLBACK);
+        _resResolver->resolveNode(_httpMethodId, _httpMethod, _httpResource, resolvedResource, websocketRequested ? WEBSOCKET : HANDLER_CALLBACK);
 
         // Is there any match (may be the defaultNode, if it is configured)
         if (resolvedResource.didMatch()) {
           // Check for client's request to keep-alive if we have a handler function.
           if (resolvedResource.getMatchingNode()->_nodeType == HANDLER_CALLBACK) {
             // Did the client set connection:keep-alive?
-            HTTPHeader * connectionHeader = _httpHeaders->get("Connection");
-            std::string connectionHeaderValue = "";
-            if (connectionHeader != NULL) {
-              connectionHeaderValue += connectionHeader->_value;
-              std::transform(
-                connectionHeaderValue.begin(),
-                connectionHeaderValue.end(),
-                connectionHeaderValue.begin(),
-                [](unsigned char c){ return ::tolower(c); }
-              );
-            }
-            if (std::string("keep-alive").compare(connectionHeaderValue)==0) {
+            // The token is case-insensitive ASCII like a header name, so it can be compared the same way
+            const char * connectionValue;
+            size_t connectionValueLength;
+            if (_httpHeaders->getValue(HEADER_CONNECTION, &connectionValue, &connectionValueLength) &&
+                headerNameEquals(connectionValue, connectionValueLength, "keep-alive", 10)) {
               HTTPS_LOGD("Keep-Alive activated. FID=%d", _socket);
               _isKeepAlive = true;
             } else {
@@ -478,16 +877,17 @@ void HTTPConnection::loop() {
             _httpHeaders,
             resolvedResource.getMatchingNode(),
             _httpMethod,
+            _httpMethodId,
             resolvedResource.getParams(),
             _httpResource
           );
-          HTTPResponse res = HTTPResponse(this);
-
-          // Add default headers to the response
-          auto allDefaultHeaders = _defaultHeaders->getAll();
-          for(std::vector<HTTPHeader*>::iterator header = allDefaultHeaders->begin(); header != allDefaultHeaders->end(); ++header) {
-            res.setHeader((*header)->_name, (*header)->_value);
+          // The default headers are added when the header is written, unless the handler overrides them
+          HTTPResponse res = HTTPResponse(this, _responseHeaders, _defaultHeaders);
+          if (_httpMethodId == METHOD_HEAD) {
+            // The handler creates the response as for GET, but only the headers are sent
+            res.omitBody();
           }
+          _responseCount++;
 
           // Find the request handler callback
           HTTPSCallbackFunction * resourceCallback;
@@ -498,25 +898,23 @@ void HTTPConnection::loop() {
             // For resource nodes, we use the callback defined by the node itself
             resourceCallback = ((ResourceNode*)resolvedResource.getMatchingNode())->_callback;
           }
-
-          // Get the current middleware chain
-          auto vecMw = _resResolver->getMiddleware();
-
-          // Anchor of the chain is the actual resource. The call to the handler is bound here
-          std::function<void()> next = std::function<void()>(std::bind(resourceCallback, &req, &res));
-
-          // Go back in the middleware chain and glue everything together
-          auto itMw = vecMw.rbegin();
-          while(itMw != vecMw.rend()) {
-            next = std::function<void()>(std::bind((*itMw), &req, &res, next));
-            itMw++;
+          bool useHandlerCache = !websocketRequested && _handlerCache != NULL && _httpMethodId == METHOD_GET &&
+            ((ResourceNode*)resolvedResource.getMatchingNode())->getHandlerCacheTTL() > 0;
+
+          // Anchor of the chain is the actual resource. For nodes with handler cache, the handler
+          // is only called if the cache has no response. Both fit into the std::function without
+          // allocating memory
+          HTTPMiddlewareChain::Handler handler;
+          if (useHandlerCache) {
+            handler = [this, resourceCallback](HTTPRequest * req, HTTPResponse * res) {
+              handleCachedRequest(resourceCallback, req, res);
+            };
+          } else {
+            handler = resourceCallback;
           }
 
-          // We insert the internal validation middleware at the start of the chain:
-          next = std::function<void()>(std::bind(&validationMiddleware, &req, &res, next));
-
-          // Call the whole chain
-          next();
+          // Call the chain of the node, which starts with its validation
+          resolvedResource.getMiddlewareChain()->run(&req, &res, handler);
 
           // The callback-function should have read all of the request body.
           // However, if it does not, we need to clear the request body now,
@@ -528,6 +926,8 @@ void HTTPConnection::loop() {
 
           // Finally, after the handshake is done, we create the WebsocketHandler and change the internal state.
           if(websocketRequested) {
+            // Send the handshake response before the handler can send its first frame
+            res.finalize();
             _wsHandler = ((WebsocketNode*)resolvedResource.getMatchingNode())->newHandler();
             _wsHandler->initialize(this);  // make websocket with this connection 
             _connectionState = STATE_WEBSOCKET;
@@ -550,8 +950,8 @@ void HTTPConnection::loop() {
                 _connectionState = STATE_BODY_FINISHED;
               }
             } else {
-              if (res.isResponseBuffered()) {
-                // If the response could be buffered:
+              if (res.isResponseBuffered() || res.isBodyComplete()) {
+                // If the response could be buffered, or its length was known in advance:
                 res.setHeader("Connection", "keep-alive");
                 res.finalize();
                 if (_clientState != CSTATE_CLOSED) {
@@ -559,12 +959,15 @@ void HTTPConnection::loop() {
                   refreshTimeout();
                   // Reset headers for the new connection
                   _httpHeaders->clearAll();
+                  _requestHead.clear();
+                  nextLine();
                   // Go back to initial state
                   _connectionState = STATE_INITIAL;
                 }
               }
               // The response could not be buffered or the client has closed:
               if (!isClosed() && _connectionState!=STATE_INITIAL) {
+                res.finalize();
                 _connectionState = STATE_BODY_FINISHED;
               }
             }
@@ -606,18 +1009,35 @@ void HTTPConnection::loop() {
       break;
     default:;
     }
+
+    // Continue as long as the request parsing makes progress
+    processNextState = _connectionState != previousState && (
+      _connectionState == STATE_INITIAL ||
+      _connectionState == STATE_REQUEST_FINISHED ||
+      _connectionState == STATE_HEADERS_FINISHED);
+    if (processNextState && _connectionState == STATE_INITIAL) {
+      // A request has been answered. Requests beyond the pipeline depth are processed in the next
+      // pass, so that one client cannot block the other connections.
+      finishedRequests++;
+      processNextState = (_bufferFill > 0 && finishedRequests < _pipelineDepth);
+    }
   }
 
+  // The readiness passed by the server is only valid for this pass
+  _readReadyKnown = false;
 }
 
 
 bool HTTPConnection::checkWebsocket() {
-  if(_httpMethod == "GET" &&
-     !_httpHeaders->getValue("Host").empty() &&
-      _httpHeaders->getValue("Upgrade") == "websocket" &&
-      _httpHeaders->getValue("Connection").find("Upgrade") != std::string::npos &&
-     !_httpHeaders->getValue("Sec-WebSocket-Key").empty() &&
-      _httpHeaders->getValue("Sec-WebSocket-Version") == "13") {
+  // Values that are only checked for presence are not copied
+  const char * value;
+  size_t length;
+  if(_httpMethodId == METHOD_GET &&
+      _httpHeaders->getValue(HEADER_HOST, &value, &length) && length > 0 &&
+      _httpHeaders->getValue(HEADER_UPGRADE) == "websocket" &&
+      _httpHeaders->getValue(HEADER_CONNECTION).find("Upgrade") != std::string::npos &&
+      _httpHeaders->getValue(HEADER_SEC_WEBSOCKET_KEY, &value, &length) && length > 0 &&
+      _httpHeaders->getValue(HEADER_SEC_WEBSOCKET_VERSION) == "13") {
 
       HTTPS_LOGI("Upgrading to WS, FID=%d", _socket);
       return true;
@@ -625,6 +1045,74 @@ bool HTTPConnection::checkWebsocket() {
       return false;
 }
 
+/**
+ * Checks the Transfer-Encoding header of the request. Only the chunked coding is implemented, so
+ * a request with any other coding is answered with 501 (RFC 7230, 3.3.1). If chunked is applied
+ * more than once or the list is empty, the request is answered with 400 (RFC 7230, 3.3.3).
+ * Returns false if an error has been raised.
+ */
+bool HTTPConnection::checkTransferEncoding() {
+  const char * value;
+  size_t length;
+  if (!_httpHeaders->getValue(HEADER_TRANSFER_ENCODING, &value, &length)) {
+    return true;
+  }
+  size_t chunkedCount = 0;
+  size_t pos = 0;
+  while (pos <= length) {
+    const char * comma = (const char *)memchr(value + pos, ',', length - pos);
+    size_t end = (comma != NULL ? comma - value : length);
+    size_t tokenStart = pos;
+    size_t tokenEnd = end;
+    while (tokenStart < tokenEnd && (value[tokenStart] == ' ' || value[tokenStart] == '\t')) {
+      tokenStart++;
+    }
+    while (tokenEnd > tokenStart && (value[tokenEnd - 1] == ' ' || value[tokenEnd - 1] == '\t')) {
+      tokenEnd--;
+    }
+    // Empty list elements are allowed and ignored (RFC 7230, 7)
+    if (tokenEnd > tokenStart) {
+      if (!headerNameEquals(value + tokenStart, tokenEnd - tokenStart, "chunked", 7)) {
+        HTTPS_LOGW("Unsupported transfer coding, FID=%d", _socket);
+        raiseError(501, "Not Implemented");
+        return false;
+      }
+      chunkedCount++;
+    }
+    pos = end + 1;
+  }
+  if (chunkedCount != 1) {
+    raiseError(400, "Bad Request");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Calls the handler of a node with handler cache, unless the cache has a response for the
+ * request. A complete response of the handler is stored in the cache.
+ */
+void HTTPConnection::handleCachedRequest(const HTTPSCallbackFunction * callback, HTTPRequest * req, HTTPResponse * res) {
+  ResourceNode * node = (ResourceNode*)req->getResolvedNode();
+  std::string key;
+  HTTPHandlerCache::buildKey(key, _httpResource.substr(0, _httpResource.find('?')), req->getParams(),
+    node->getCacheKeyParameters());
+
+  std::shared_ptr<const HTTPHandlerCache::Response> cached = _handlerCache->get(key, millis());
+  if (cached) {
+    HTTPS_LOGD("Sending response from cache");
+    res->replay(*cached);
+    return;
+  }
+
+  std::shared_ptr<HTTPHandlerCache::Response> recording = std::make_shared<HTTPHandlerCache::Response>();
+  res->startRecording(recording.get(), _handlerCache->getMaxEntrySize());
+  callback(req, res);
+  if (res->finishRecording()) {
+    _handlerCache->put(key, recording, node->getHandlerCacheTTL(), millis());
+  }
+}
+
 /**
  * Middleware function that handles the validation of parameters
  */
@@ -663,7 +1151,7 @@ void handleWebsocketHandshake(HTTPRequest * req, HTTPResponse * res) {
   res->setStatusText("Switching Protocols");
   res->setHeader("Upgrade", "websocket");
   res->setHeader("Connection", "Upgrade");
-  res->setHeader("Sec-WebSocket-Accept", websocketKeyResponseHash(req->getHeader("Sec-WebSocket-Key")));
+  res->setHeader("Sec-WebSocket-Accept", websocketKeyResponseHash(req->getHTTPHeaders()->getValue(HEADER_SEC_WEBSOCKET_KEY)));
   res->print("");
 }
 
@@ -8,6 +8,7 @@
 #include <mbedtls/base64.h>
 #include <esp32/sha.h>
 #include <functional>
+#include <atomic>
 
 // Required for sockets
 #include "lwip/netdb.h"
@@ -16,6 +17,9 @@
 
 #include "HTTPSServerConstants.hpp"
 #include "ConnectionContext.hpp"
+#include "HTTPBufferPool.hpp"
+#include "HTTPErrorResponses.hpp"
+#include "HTTPHandlerCache.hpp"
 
 #include "HTTPHeaders.hpp"
 #include "HTTPHeader.hpp"
@@ -37,28 +41,51 @@ namespace httpsserver {
  */
 class HTTPConnection : private ConnectionContext {
 public:
-  HTTPConnection(ResourceResolver * resResolver);
+  HTTPConnection(ResourceResolver * resResolver, size_t receiveBufferSize = HTTPS_CONNECTION_DATA_CHUNK_SIZE);
   virtual ~HTTPConnection();
 
   virtual int initialize(int serverSocketID, HTTPHeaders *defaultHeaders);
+  void setAcceptedSocket(int socket, const struct sockaddr * addr, socklen_t addrLen);
+  void setPipelineDepth(uint8_t pipelineDepth);
+  void setBufferPool(HTTPBufferPool * bufferPool);
+  void setErrorResponses(HTTPErrorResponses * errorResponses);
+  void setHandlerCache(HTTPHandlerCache * handlerCache);
+  virtual void reset();
   virtual void handleRequest(int status, const char* msg);
   virtual void closeConnection();
   virtual bool isSecure();
+  virtual bool isKeepAlive();
+  virtual bool isChunkedAllowed();
   virtual IPAddress getClientIP();
 
   void loop();
   bool isClosed();
   bool isError();
 
+  int getSocket();
+  uint32_t getAllocationCount();
+  uint32_t getResponseCount();
+  uint32_t getWriteCount();
+  uint32_t getRecordCount();
+  bool hasPendingData();
+  bool needsProcessing();
+  virtual bool isWaitingForWrite();
+  void setReadReady(bool readReady);
+
 protected:
   friend class HTTPRequest;
   friend class HTTPResponse;
   friend class WebsocketInputStreambuf;
 
   virtual size_t writeBuffer(byte* buffer, size_t length);
+  virtual size_t writeBuffers(const ConnectionBufferSegment * segments, size_t count);
   virtual size_t readBytesToBuffer(byte* buffer, size_t length);
   virtual bool canReadData();
   virtual size_t pendingByteCount();
+  virtual bool continueHandshake();
+
+  size_t getMaxCacheSize();
+  void refreshTimeout();
 
   // Timestamp of the last transmission action
   unsigned long _lastTransmissionTS;
@@ -66,8 +93,29 @@ protected:
   // Timestamp of when the shutdown was started
   unsigned long _shutdownTS;
 
+  // Timestamp of when the handshake was started
+  unsigned long _handshakeTS;
+
+  // Number of heap allocations done by this connection object for its own storage (headers, TLS
+  // context). As the storage is reused by reset(), this should not grow with the number of connections.
+  // Atomic, as the value is read by HTTPServer::getWorkerStats() from other threads.
+  std::atomic<uint32_t> _allocationCount;
+
+  // Number of responses, of writes to the socket (or SSL_write() calls) and of TLS records sent
+  // by this connection object, over all sockets it has been used for. Read like _allocationCount.
+  std::atomic<uint32_t> _responseCount;
+  std::atomic<uint32_t> _writeCount;
+  std::atomic<uint32_t> _recordCount;
+
+  // Readiness of the socket as reported by the server's multiplexer for the current loop pass.
+  // If _readReadyKnown is set, the next call to canReadData() uses _readReady instead of select()
+  bool _readReadyKnown;
+  bool _readReady;
+
   // Internal state machine of the connection:
   //
+  // (HTTPS only: STATE_UNDEFINED -- initialize() --> STATE_HANDSHAKE -- handshake done --> STATE_INITIAL)
+  //
   // O --- > STATE_UNDEFINED -- initialize() --> STATE_INITIAL -- get / http/1.1 --> STATE_REQUEST_FINISHED --.
   //                     |                          |                                       |                 |
   //                     |                          |                                       |                 | Host: ...\r\n
@@ -85,6 +133,8 @@ protected:
 
     // The connection has not been established yet
     STATE_UNDEFINED,
+    // The TLS handshake is in progress (HTTPS only)
+    STATE_HANDSHAKE,
     // The connection has just been created
     STATE_INITIAL,
     // The request line has been parsed
@@ -111,10 +161,11 @@ protected:
 
 private:
   void raiseError(uint16_t code, std::string reason);
-  void readLine(int lengthLimit);
+  void readLine(size_t lengthLimit);
+  void nextLine();
 
   bool isTimeoutExceeded();
-  void refreshTimeout();
+  bool isHandshakeTimeoutExceeded();
 
   int updateBuffer();
   size_t pendingBufferSize();
@@ -122,16 +173,34 @@ private:
   void signalClientClose();
   void signalRequestError();
   size_t readBuffer(byte* buffer, size_t length);
+  size_t peekBuffer(const byte ** data);
+  void skipBuffer(size_t length);
+  bool isInputClosed();
   size_t getCacheSize();
+  byte * acquireResponseBuffer(size_t minSize, size_t * size);
+  void releaseResponseBuffer(byte * buffer, size_t size);
   bool checkWebsocket();
+  bool checkTransferEncoding();
+  void handleCachedRequest(const HTTPSCallbackFunction * callback, HTTPRequest * req, HTTPResponse * res);
 
-  // The receive buffer
-  char _receiveBuffer[HTTPS_CONNECTION_DATA_CHUNK_SIZE];
+  // Access to the circular receive buffer
+  size_t bufferReadSpan(char ** data);
+  size_t bufferWriteSpan(char ** data);
+  void bufferConsume(size_t length);
 
-  // First index on _receive_buffer that has not been processed yet (anything before may be discarded)
-  int _bufferProcessed;
-  // The index on the receive_buffer that is the first one which is empty at the end.
-  int _bufferUnusedIdx;
+  // The receive buffer. It is used as circular buffer, so processed data never has to be moved:
+  //
+  // [ free | unprocessed data ...                     | free ]      or     [ ... data | free | unprocessed ...]
+  //        ^ _bufferReadIdx                                                                 ^ _bufferReadIdx
+  //          <-------------- _bufferFill ------------>
+  char * _receiveBuffer;
+  // Capacity of the receive buffer
+  const size_t _receiveBufferSize;
+
+  // First index on _receiveBuffer that has not been processed yet
+  size_t _bufferReadIdx;
+  // Number of bytes starting at _bufferReadIdx that have not been processed yet (may wrap around)
+  size_t _bufferFill;
 
   // Socket address, length etc for the connection
   struct sockaddr _sockAddr;
@@ -141,23 +210,49 @@ private:
   // Resource resolver used to resolve resources
   ResourceResolver * _resResolver;
 
-  // The parser line. The struct is used to read the next line up to the \r\n in readLine()
+  // Request line and headers of the current request, without the \r\n line endings. Lines are
+  // copied in bulk from the receive buffer, and the parser only records offsets into this string.
+  // It is cleared for each request, so its capacity can be reused.
+  std::string _requestHead;
+
+  // The parser line. The struct is used to read the next line up to the \r\n in readLine().
+  // The line is located at _requestHead[start, start+length)
   struct {
-    std::string text = "";
+    size_t start = 0;
+    size_t length = 0;
     bool parsingFinished = false;
   } _parserLine;
 
   // HTTP properties: Method, Request, Headers
   std::string _httpMethod;
+  // The method identified once when the request line is parsed
+  HTTPMethodId _httpMethodId;
   std::string _httpResource;
+  // True if the request line has HTTP/1.1 (or a later 1.x version). HTTP/1.0 clients do not understand chunked bodies
+  bool _isHTTP11;
   HTTPHeaders * _httpHeaders;
 
+  // Storage for the response headers, reused for each request
+  HTTPHeaders * _responseHeaders;
+
   // Default headers that are applied to every response
   HTTPHeaders * _defaultHeaders;
 
   // Should we use keep alive
   bool _isKeepAlive;
 
+  // Maximum number of pipelined requests that are processed in one call to loop()
+  uint8_t _pipelineDepth;
+
+  // Pool for the response buffers, owned by the worker. NULL if the buffers are allocated for each response
+  HTTPBufferPool * _bufferPool;
+
+  // Serialized error responses, owned by the server. NULL if the built-in responses are used
+  HTTPErrorResponses * _errorResponses;
+
+  // Cache for the responses of nodes that enable it, owned by the server. NULL if not used
+  HTTPHandlerCache * _handlerCache;
+
   //Websocket connection
   WebsocketHandler * _wsHandler;
 
@@ -0,0 +1,118 @@
+#include "HTTPErrorResponses.hpp"
+
+namespace httpsserver {
+
+// Creates the serialized response for an error with the default body "<code> <reason>". The
+// length is passed as string, as it is part of the literal.
+#define HTTPS_ERROR_RESPONSE(code, reason, bodyLength) \
+  "HTTP/1.1 " code " " reason "\r\n" \
+  "Connection: close\r\n" \
+  "Content-Type: text/plain;charset=utf8\r\n" \
+  "Content-Length: " bodyLength "\r\n" \
+  "\r\n" \
+  code " " reason
+
+namespace {
+
+struct BuiltinErrorResponse {
+  uint16_t code;
+  const char * reason;
+  const char * response;
+  size_t length;
+};
+
+const char RESPONSE_400[] = HTTPS_ERROR_RESPONSE("400", "Bad Request", "15");
+const char RESPONSE_404[] = HTTPS_ERROR_RESPONSE("404", "Not Found", "13");
+const char RESPONSE_431[] = HTTPS_ERROR_RESPONSE("431", "Request Header Fields Too Large", "35");
+
+const BuiltinErrorResponse BUILTIN_RESPONSES[] = {
+  {400, "Bad Request", RESPONSE_400, sizeof(RESPONSE_400) - 1},
+  {404, "Not Found", RESPONSE_404, sizeof(RESPONSE_404) - 1},
+  {431, "Request Header Fields Too Large", RESPONSE_431, sizeof(RESPONSE_431) - 1},
+};
+
+const size_t BUILTIN_RESPONSE_COUNT = sizeof(BUILTIN_RESPONSES) / sizeof(BUILTIN_RESPONSES[0]);
+
+} /* namespace */
+
+#undef HTTPS_ERROR_RESPONSE
+
+HTTPErrorResponses::HTTPErrorResponses() {
+
+}
+
+HTTPErrorResponses::~HTTPErrorResponses() {
+
+}
+
+/**
+ * Replaces the body of the error response with the given status code.
+ *
+ * The response is serialized by this call. It is not thread-safe, so it should not be called while
+ * the server is running.
+ */
+void HTTPErrorResponses::setBody(uint16_t code, std::string const &body, std::string const &contentType) {
+  Entry entry;
+  entry.code = code;
+  serialize(entry.response, code, getReason(code), body, contentType);
+  for(std::vector<Entry>::iterator it = _custom.begin(); it != _custom.end(); ++it) {
+    if (it->code == code) {
+      it->response.swap(entry.response);
+      return;
+    }
+  }
+  _custom.push_back(entry);
+}
+
+/**
+ * Provides the serialized response for the status code, without copying it.
+ *
+ * Returns false if neither a custom body has been set nor a built-in response exists for the code.
+ */
+bool HTTPErrorResponses::get(uint16_t code, const byte ** data, size_t * length) {
+  for(std::vector<Entry>::iterator it = _custom.begin(); it != _custom.end(); ++it) {
+    if (it->code == code) {
+      *data = (const byte *)it->response.data();
+      *length = it->response.length();
+      return true;
+    }
+  }
+  for(size_t i = 0; i < BUILTIN_RESPONSE_COUNT; i++) {
+    if (BUILTIN_RESPONSES[i].code == code) {
+      *data = (const byte *)BUILTIN_RESPONSES[i].response;
+      *length = BUILTIN_RESPONSES[i].length;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Appends a complete error response, including the Connection: close header, to the buffer.
+ */
+void HTTPErrorResponses::serialize(std::string &buffer, uint16_t code, std::string const &reason,
+    std::string const &body, std::string const &contentType) {
+  char line[64];
+  snprintf(line, sizeof(line), "HTTP/1.1 %u ", (unsigned)code);
+  buffer.append(line);
+  buffer.append(reason);
+  buffer.append("\r\nConnection: close\r\nContent-Type: ");
+  buffer.append(contentType);
+  snprintf(line, sizeof(line), "\r\nContent-Length: %u\r\n\r\n", (unsigned)body.length());
+  buffer.append(line);
+  buffer.append(body);
+}
+
+/**
+ * Returns the reason phrase of the built-in responses, or "Error" for other status codes.
+ */
+const char * HTTPErrorResponses::getReason(uint16_t code) {
+  for(size_t i = 0; i < BUILTIN_RESPONSE_COUNT; i++) {
+    if (BUILTIN_RESPONSES[i].code == code) {
+      return BUILTIN_RESPONSES[i].reason;
+    }
+  }
+  return "Error";
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,51 @@
+#ifndef SRC_HTTPERRORRESPONSES_HPP_
+#define SRC_HTTPERRORRESPONSES_HPP_
+
+#include <Arduino.h>
+
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <vector>
+
+#include "HTTPSServerConstants.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Serialized responses for errors that the connection answers itself
+ *
+ * If a request cannot be parsed, or if no node matches and no default node is
+ * set, the connection sends an error response and closes. These responses
+ * (status line, headers and body) are stored fully serialized, so they are sent
+ * with a single write.
+ *
+ * The responses for 400, 404 and 431 are string constants. Custom bodies can be
+ * set with HTTPServer::setErrorBody(), they are serialized when they are set.
+ */
+class HTTPErrorResponses {
+public:
+  HTTPErrorResponses();
+  virtual ~HTTPErrorResponses();
+
+  void setBody(uint16_t code, std::string const &body, std::string const &contentType);
+  bool get(uint16_t code, const byte ** data, size_t * length);
+
+  static void serialize(std::string &buffer, uint16_t code, std::string const &reason,
+    std::string const &body, std::string const &contentType);
+  static const char * getReason(uint16_t code);
+
+private:
+  struct Entry {
+    uint16_t code;
+    std::string response;
+  };
+
+  // Responses with custom bodies
+  std::vector<Entry> _custom;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPERRORRESPONSES_HPP_ */
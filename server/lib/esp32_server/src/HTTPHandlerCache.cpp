@@ -0,0 +1,164 @@
+#include "HTTPHandlerCache.hpp"
+
+namespace httpsserver {
+
+HTTPHandlerCache::HTTPHandlerCache(size_t capacity):
+  _capacity(capacity),
+  _bytes(0),
+  _hits(0),
+  _misses(0),
+  _stores(0),
+  _evictions(0),
+  _expirations(0) {
+  pthread_mutex_init(&_mutex, NULL);
+}
+
+HTTPHandlerCache::~HTTPHandlerCache() {
+  pthread_mutex_destroy(&_mutex);
+}
+
+/**
+ * Sets the maximum number of bytes that the cache holds. Responses are removed if the cache
+ * already holds more.
+ */
+void HTTPHandlerCache::setCapacity(size_t capacity) {
+  pthread_mutex_lock(&_mutex);
+  _capacity = capacity;
+  evict(0);
+  pthread_mutex_unlock(&_mutex);
+}
+
+/**
+ * Returns the size of the largest response (head and body) that is stored
+ */
+size_t HTTPHandlerCache::getMaxEntrySize() {
+  return _capacity / 4;
+}
+
+/**
+ * Returns the response stored for the key, or an empty pointer if there is none or if it has
+ * expired. now is the current time in milliseconds, as returned by millis().
+ */
+std::shared_ptr<const HTTPHandlerCache::Response> HTTPHandlerCache::get(std::string const &key, unsigned long now) {
+  std::shared_ptr<const Response> response;
+  pthread_mutex_lock(&_mutex);
+  std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = _index.find(key);
+  if (it != _index.end()) {
+    std::list<Entry>::iterator entry = it->second;
+    // Compared as difference, so it works when millis() wraps around
+    if ((long)(entry->expires - now) > 0) {
+      _entries.splice(_entries.begin(), _entries, entry);
+      response = entry->response;
+    } else {
+      remove(entry);
+      _expirations++;
+    }
+  }
+  if (response) {
+    _hits++;
+  } else {
+    _misses++;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return response;
+}
+
+/**
+ * Stores a response for ttl milliseconds. It replaces a response that is stored for the same key.
+ * Responses larger than getMaxEntrySize() are not stored.
+ */
+void HTTPHandlerCache::put(std::string const &key, std::shared_ptr<const Response> response, unsigned long ttl,
+    unsigned long now) {
+  size_t responseSize = response->statusText.size() + response->headers.size() + response->body.size();
+  size_t size = key.size() + responseSize;
+  if (responseSize > getMaxEntrySize()) {
+    HTTPS_LOGD("Response for %s is too large for the cache", key.c_str());
+    return;
+  }
+  pthread_mutex_lock(&_mutex);
+  std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = _index.find(key);
+  if (it != _index.end()) {
+    remove(it->second);
+  }
+  evict(size);
+  Entry entry;
+  entry.key = key;
+  entry.response = response;
+  entry.expires = now + ttl;
+  entry.size = size;
+  _entries.push_front(entry);
+  _index[key] = _entries.begin();
+  _bytes += size;
+  _stores++;
+  pthread_mutex_unlock(&_mutex);
+}
+
+/**
+ * Removes all responses
+ */
+void HTTPHandlerCache::clear() {
+  pthread_mutex_lock(&_mutex);
+  _entries.clear();
+  _index.clear();
+  _bytes = 0;
+  pthread_mutex_unlock(&_mutex);
+}
+
+HTTPHandlerCacheStats HTTPHandlerCache::getStats() {
+  HTTPHandlerCacheStats stats;
+  pthread_mutex_lock(&_mutex);
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.stores = _stores;
+  stats.evictions = _evictions;
+  stats.expirations = _expirations;
+  stats.entries = _entries.size();
+  stats.bytes = _bytes;
+  stats.capacity = _capacity;
+  pthread_mutex_unlock(&_mutex);
+  return stats;
+}
+
+/**
+ * Creates the key of a request from its path (without query) and the values of the query
+ * parameters in keyParameters. Other query parameters do not affect the key.
+ *
+ * The values are prefixed with their length, so a value cannot imitate another parameter.
+ */
+void HTTPHandlerCache::buildKey(std::string &key, std::string const &path, ResourceParameters * params,
+    std::vector<std::string> const &keyParameters) {
+  key = path;
+  std::string value;
+  for(std::vector<std::string>::const_iterator it = keyParameters.begin(); it != keyParameters.end(); ++it) {
+    if (params->getQueryParameter(*it, value)) {
+      key += '\n';
+      key += intToString(value.size());
+      key += ':';
+      key += value;
+    } else {
+      key += "\n-";
+    }
+  }
+}
+
+/**
+ * Removes an entry. The mutex must be held.
+ */
+void HTTPHandlerCache::remove(std::list<Entry>::iterator entry) {
+  _bytes -= entry->size;
+  _index.erase(entry->key);
+  _entries.erase(entry);
+}
+
+/**
+ * Removes the least recently used entries until required more bytes fit into the cache. The mutex
+ * must be held.
+ */
+void HTTPHandlerCache::evict(size_t required) {
+  while (!_entries.empty() && _bytes + required > _capacity) {
+    remove(--_entries.end());
+    _evictions++;
+  }
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,119 @@
+#ifndef SRC_HTTPHANDLERCACHE_HPP_
+#define SRC_HTTPHANDLERCACHE_HPP_
+
+#include <Arduino.h>
+
+#include <pthread.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <vector>
+
+#include "HTTPSServerConstants.hpp"
+#include "ResourceParameters.hpp"
+#include "util.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Statistics of an HTTPHandlerCache, see HTTPServer::getHandlerCacheStats()
+ */
+struct HTTPHandlerCacheStats {
+  /** Number of requests that have been answered from the cache */
+  uint32_t hits;
+  /** Number of requests to cached nodes that had to call the handler */
+  uint32_t misses;
+  /** Number of responses that have been stored */
+  uint32_t stores;
+  /** Number of responses that have been removed to make room for others */
+  uint32_t evictions;
+  /** Number of responses that have been removed because their TTL had passed */
+  uint32_t expirations;
+  /** Number of responses that are currently held */
+  uint32_t entries;
+  /** Number of bytes currently held, counting keys, headers and bodies */
+  uint32_t bytes;
+  /** Maximum number of bytes that the cache holds */
+  uint32_t capacity;
+};
+
+/**
+ * \brief Stores complete responses of handlers for replay, see ResourceNode::setHandlerCacheTTL()
+ *
+ * The responses are kept in least-recently-used order. When a new response
+ * would exceed the capacity, the least recently used ones are removed. A single
+ * response may use at most a quarter of the capacity, so it cannot flush the
+ * whole cache.
+ *
+ * Entries are shared with the connections that send them, so removing an entry
+ * does not affect a response that is being sent. The cache is thread-safe and is
+ * shared by all workers of a server.
+ */
+class HTTPHandlerCache {
+public:
+  /**
+   * \brief A response in the cache
+   */
+  struct Response {
+    /** Status code of the response */
+    uint16_t statusCode;
+    /** Status text of the response */
+    std::string statusText;
+    /**
+     * The headers that the handler has set, like "Name: value\r\n". Headers of the middleware,
+     * default headers and the headers that depend on the connection are not stored
+     */
+    std::string headers;
+    /** The body of the response */
+    std::string body;
+  };
+
+  HTTPHandlerCache(size_t capacity = HTTPS_HANDLER_CACHE_SIZE);
+  virtual ~HTTPHandlerCache();
+
+  void setCapacity(size_t capacity);
+  size_t getMaxEntrySize();
+
+  std::shared_ptr<const Response> get(std::string const &key, unsigned long now);
+  void put(std::string const &key, std::shared_ptr<const Response> response, unsigned long ttl, unsigned long now);
+  void clear();
+
+  HTTPHandlerCacheStats getStats();
+
+  static void buildKey(std::string &key, std::string const &path, ResourceParameters * params,
+    std::vector<std::string> const &keyParameters);
+
+private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const Response> response;
+    unsigned long expires;
+    size_t size;
+  };
+
+  void remove(std::list<Entry>::iterator entry);
+  void evict(size_t required);
+
+  // Entries, the most recently used first
+  std::list<Entry> _entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+  size_t _capacity;
+  size_t _bytes;
+
+  uint32_t _hits;
+  uint32_t _misses;
+  uint32_t _stores;
+  uint32_t _evictions;
+  uint32_t _expirations;
+
+  pthread_mutex_t _mutex;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPHANDLERCACHE_HPP_ */
@@ -1,11 +1,58 @@
 #include "HTTPHeader.hpp"
 
-#include <locale>
-#include <ostream>
-#include <sstream>
 
 namespace httpsserver {
 
+namespace {
+
+// Header names are case-insensitive ASCII (RFC 7230, 3.2). The tables replace the locale-dependent
+// functions of <cctype>, which are slower and would also map non-ASCII bytes.
+
+// Lowercase of each byte. Only A-Z are changed
+const uint8_t HEADER_CHAR_LOWER[256] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+  0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+  0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+  0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+  0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+  0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+  0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+  0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+  0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+  0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+};
+
+const uint8_t HEADER_CHAR_ALPHA = 0x01;
+const uint8_t HEADER_CHAR_DIGIT = 0x02;
+
+// Class of each byte: HEADER_CHAR_ALPHA for A-Z and a-z, HEADER_CHAR_DIGIT for 0-9, 0 otherwise
+const uint8_t HEADER_CHAR_CLASS[256] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+} /* namespace */
+
 HTTPHeader::HTTPHeader(const std::string &name, const std::string &value):
   _name(normalizeHeaderName(name)),
   _value(value) {
@@ -21,23 +68,119 @@ std::string HTTPHeader::print() {
 }
 
 std::string normalizeHeaderName(std::string const &name) {
-  std::locale loc;
-  std::stringbuf buf;
-  std::ostream oBuf(&buf);
+  std::string normalized(name);
+  if (!normalized.empty()) {
+    normalizeHeaderName(&normalized[0], normalized.length());
+  }
+  return normalized;
+}
+
+void normalizeHeaderName(char * name, size_t length) {
+  // The first character and every character after a non-alphanumeric one are uppercase
   bool upper = true;
-  std::string::size_type len = name.length();
-  for (std::string::size_type i = 0; i < len; ++i) {
+  for (size_t i = 0; i < length; ++i) {
+    uint8_t c = name[i];
+    uint8_t charClass = HEADER_CHAR_CLASS[c];
     if (upper) {
-      oBuf << std::toupper(name[i], loc);
+      if (charClass == HEADER_CHAR_ALPHA) {
+        name[i] = c & ~0x20;
+      }
       upper = false;
     } else {
-      oBuf << std::tolower(name[i], loc);
-      if (!std::isalnum(name[i], loc)) {
-        upper=true;
+      if (charClass == HEADER_CHAR_ALPHA) {
+        name[i] = c | 0x20;
       }
+      upper = (charClass == 0);
     }
   }
-  return buf.str();
+}
+
+bool headerNameEquals(const char * name, size_t nameLength, std::string const &other) {
+  return headerNameEquals(name, nameLength, other.data(), other.length());
+}
+
+bool headerNameEquals(const char * name, size_t nameLength, const char * other, size_t otherLength) {
+  if (nameLength != otherLength) {
+    return false;
+  }
+  const uint8_t * a = (const uint8_t *)name;
+  const uint8_t * b = (const uint8_t *)other;
+  for (size_t i = 0; i < nameLength; ++i) {
+    if (HEADER_CHAR_LOWER[a[i]] != HEADER_CHAR_LOWER[b[i]]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+// Names of the HTTPHeaderId values, in the same order
+const char * const KNOWN_HEADER_NAMES[HEADER_COUNT] = {
+  "",
+  "connection",
+  "content-length",
+  "content-type",
+  "host",
+  "transfer-encoding",
+  "upgrade",
+  "sec-websocket-accept",
+  "sec-websocket-extensions",
+  "sec-websocket-key",
+  "sec-websocket-protocol",
+  "sec-websocket-version",
+};
+
+bool knownHeaderEquals(const char * name, size_t nameLength, HTTPHeaderId id) {
+  const char * knownName = KNOWN_HEADER_NAMES[id];
+  for (size_t i = 0; i < nameLength; ++i) {
+    if (HEADER_CHAR_LOWER[(uint8_t)name[i]] != (uint8_t)knownName[i]) {
+      return false;
+    }
+  }
+  return knownName[nameLength] == '\0';
+}
+
+} /* namespace */
+
+HTTPHeaderId identifyHeaderName(const char * name, size_t nameLength) {
+  // The length and the first character are sufficient to select the candidate
+  HTTPHeaderId candidate = HEADER_UNKNOWN;
+  switch (nameLength) {
+  case 4:
+    candidate = HEADER_HOST;
+    break;
+  case 7:
+    candidate = HEADER_UPGRADE;
+    break;
+  case 10:
+    candidate = HEADER_CONNECTION;
+    break;
+  case 12:
+    candidate = HEADER_CONTENT_TYPE;
+    break;
+  case 14:
+    candidate = HEADER_CONTENT_LENGTH;
+    break;
+  case 17:
+    candidate = (name[0] == 't' || name[0] == 'T') ? HEADER_TRANSFER_ENCODING : HEADER_SEC_WEBSOCKET_KEY;
+    break;
+  case 20:
+    candidate = HEADER_SEC_WEBSOCKET_ACCEPT;
+    break;
+  case 21:
+    candidate = HEADER_SEC_WEBSOCKET_VERSION;
+    break;
+  case 22:
+    candidate = HEADER_SEC_WEBSOCKET_PROTOCOL;
+    break;
+  case 24:
+    candidate = HEADER_SEC_WEBSOCKET_EXTENSIONS;
+    break;
+  default:
+    return HEADER_UNKNOWN;
+  }
+  return knownHeaderEquals(name, nameLength, candidate) ? candidate : HEADER_UNKNOWN;
 }
 
 } /* namespace httpsserver */
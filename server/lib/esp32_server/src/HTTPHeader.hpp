@@ -6,6 +6,29 @@
 
 namespace httpsserver {
 
+/**
+ * \brief Headers that are identified when they are added to HTTPHeaders
+ *
+ * These are the headers that the server itself evaluates for each request or
+ * response. HTTPHeaders can look them up without comparing names.
+ */
+enum HTTPHeaderId {
+  HEADER_UNKNOWN,
+  HEADER_CONNECTION,
+  HEADER_CONTENT_LENGTH,
+  HEADER_CONTENT_TYPE,
+  HEADER_HOST,
+  HEADER_TRANSFER_ENCODING,
+  HEADER_UPGRADE,
+  HEADER_SEC_WEBSOCKET_ACCEPT,
+  HEADER_SEC_WEBSOCKET_EXTENSIONS,
+  HEADER_SEC_WEBSOCKET_KEY,
+  HEADER_SEC_WEBSOCKET_PROTOCOL,
+  HEADER_SEC_WEBSOCKET_VERSION,
+  // Number of ids, not a header
+  HEADER_COUNT
+};
+
 /**
  * \brief Represents a single name/value pair of an HTTP header
  */
@@ -27,6 +50,27 @@ public:
  */
 std::string normalizeHeaderName(std::string const &name);
 
+/**
+ * \brief Normalizes case in a header name in place, see normalizeHeaderName()
+ */
+void normalizeHeaderName(char * name, size_t length);
+
+/**
+ * \brief Compares two header names, ignoring case
+ *
+ * The result is the same as comparing both names after normalizeHeaderName(),
+ * but nothing has to be copied.
+ */
+bool headerNameEquals(const char * name, size_t nameLength, std::string const &other);
+bool headerNameEquals(const char * name, size_t nameLength, const char * other, size_t otherLength);
+
+/**
+ * \brief Returns the HTTPHeaderId for a header name, or HEADER_UNKNOWN
+ *
+ * The name is compared ignoring case.
+ */
+HTTPHeaderId identifyHeaderName(const char * name, size_t nameLength);
+
 } /* namespace httpsserver */
 
 #endif /* SRC_HTTPHEADER_HPP_ */
@@ -3,59 +3,324 @@
 namespace httpsserver {
 
 HTTPHeaders::HTTPHeaders() {
-  _headers = new std::vector<HTTPHeader *>();
-
+  _rawSource = NULL;
+  _keepSerialized = false;
+  _entries.reserve(HTTPS_REQUEST_MAX_HEADERS);
+  for(int i = 0; i < HEADER_COUNT; i++) {
+    _index[i] = -1;
+  }
 }
 
 HTTPHeaders::~HTTPHeaders() {
   clearAll();
-  delete _headers;
 }
 
+/**
+ * Returns the header with the given name, or NULL.
+ *
+ * The HTTPHeader instance is created by this call if the header has not been requested before.
+ * If possible, use getValue() instead, which does not allocate an instance.
+ */
 HTTPHeader * HTTPHeaders::get(std::string const &name) {
-  std::string normalizedName = normalizeHeaderName(name);
-  for(std::vector<HTTPHeader*>::iterator header = _headers->begin(); header != _headers->end(); ++header) {
-    if ((*header)->_name.compare(normalizedName)==0) {
-      return (*header);
-    }
+  int idx = find(name);
+  if (idx < 0) {
+    return NULL;
   }
-  return NULL;
+  return materialize(_entries[idx]);
 }
 
 std::string HTTPHeaders::getValue(std::string const &name) {
-  std::string normalizedName = normalizeHeaderName(name);
-  for(std::vector<HTTPHeader*>::iterator header = _headers->begin(); header != _headers->end(); ++header) {
-    if ((*header)->_name.compare(normalizedName)==0) {
-      return ((*header)->_value);
-    }
+  int idx = find(name);
+  if (idx < 0) {
+    return "";
   }
-  return "";
+  return std::string(entryData(_entries[idx]) + _entries[idx].valueOffset, _entries[idx].valueLength);
 }
 
+std::string HTTPHeaders::getValue(HTTPHeaderId id) {
+  const char * value;
+  size_t length;
+  if (!getValue(id, &value, &length)) {
+    return "";
+  }
+  return std::string(value, length);
+}
+
+/**
+ * Provides the value of a known header without copying it.
+ *
+ * Returns false if the header is not set. The value is not null-terminated, and it is only valid
+ * until the headers are modified.
+ */
+bool HTTPHeaders::getValue(HTTPHeaderId id, const char ** value, size_t * length) {
+  if (id <= HEADER_UNKNOWN || id >= HEADER_COUNT || _index[id] < 0) {
+    return false;
+  }
+  Entry &entry = _entries[_index[id]];
+  *value = entryData(entry) + entry.valueOffset;
+  *length = entry.valueLength;
+  return true;
+}
 
+bool HTTPHeaders::isSet(HTTPHeaderId id) {
+  return id > HEADER_UNKNOWN && id < HEADER_COUNT && _index[id] >= 0;
+}
+
+bool HTTPHeaders::isSet(std::string const &name) {
+  return find(name) >= 0;
+}
+
+/**
+ * Sets a header, replacing any header of the same name.
+ *
+ * The HTTPHeaders instance takes ownership of the header. Use set(name, value) to avoid the
+ * allocation of the HTTPHeader.
+ */
 void HTTPHeaders::set(HTTPHeader * header) {
-  for(int i = 0; i < _headers->size(); i++) {
-    if ((*_headers)[i]->_name.compare(header->_name)==0) {
-      delete (*_headers)[i];
-      (*_headers)[i] = header;
-      return;
+  setEntry(header->_name.data(), header->_name.length(), header->_value.data(), header->_value.length(), header);
+}
+
+/**
+ * Sets a header, replacing any header of the same name.
+ *
+ * Name and value are copied into the header storage.
+ */
+void HTTPHeaders::set(std::string const &name, std::string const &value) {
+  setEntry(name.data(), name.length(), value.data(), value.length(), NULL);
+}
+
+/**
+ * Returns all headers as HTTPHeader instances.
+ *
+ * The instances are created by this call if they have not been requested before. The vector is
+ * owned by this object and updated by the next call of getAll().
+ */
+std::vector<HTTPHeader *> * HTTPHeaders::getAll() {
+  _all.clear();
+  for(std::vector<Entry>::iterator entry = _entries.begin(); entry != _entries.end(); ++entry) {
+    _all.push_back(materialize(*entry));
+  }
+  return &_all;
+}
+
+size_t HTTPHeaders::getCount() {
+  return _entries.size();
+}
+
+/**
+ * Appends all headers to the buffer, each one as "Name: value\r\n"
+ */
+void HTTPHeaders::serialize(std::string &buffer) {
+  for(std::vector<Entry>::iterator entry = _entries.begin(); entry != _entries.end(); ++entry) {
+    serializeEntry(buffer, *entry);
+  }
+}
+
+/**
+ * Appends all headers that are not set in excluded to the buffer, like serialize().
+ *
+ * This is used to combine the default headers with the headers of a response, where the response
+ * overrides the defaults. If keepSerialized() has been called and no header is excluded, the
+ * stored block is appended as a whole.
+ */
+void HTTPHeaders::serializeWithout(std::string &buffer, HTTPHeaders &excluded) {
+  bool anyExcluded = false;
+  for(std::vector<Entry>::iterator entry = _entries.begin(); entry != _entries.end() && !anyExcluded; ++entry) {
+    anyExcluded = containsName(excluded, *entry);
+  }
+  if (!anyExcluded) {
+    if (_keepSerialized) {
+      buffer.append(_serialized);
+    } else {
+      serialize(buffer);
+    }
+    return;
+  }
+  for(std::vector<Entry>::iterator entry = _entries.begin(); entry != _entries.end(); ++entry) {
+    if (!containsName(excluded, *entry)) {
+      serializeEntry(buffer, *entry);
     }
   }
-  _headers->push_back(header);
 }
 
-std::vector<HTTPHeader *> * HTTPHeaders::getAll() {
-  return _headers;
+/**
+ * Keeps the serialized form of the headers from now on, which is updated by each change.
+ *
+ * Use this for headers that are written far more often than they are modified. As the block is
+ * not created lazily, serializeWithout() can be called by several threads at the same time as long
+ * as the headers are not modified.
+ */
+void HTTPHeaders::keepSerialized() {
+  _keepSerialized = true;
+  updateSerialized();
 }
 
 /**
  * Deletes all headers
+ *
+ * The storage is kept, so that the next request does not need to allocate it again.
  */
 void HTTPHeaders::clearAll() {
-  for(std::vector<HTTPHeader*>::iterator header = _headers->begin(); header != _headers->end(); ++header) {
-    delete (*header);
+  for(std::vector<Entry>::iterator entry = _entries.begin(); entry != _entries.end(); ++entry) {
+    delete entry->header;
+  }
+  _entries.clear();
+  _arena.clear();
+  _all.clear();
+  for(int i = 0; i < HEADER_COUNT; i++) {
+    _index[i] = -1;
+  }
+  _rawSource = NULL;
+  _serialized.clear();
+}
+
+/**
+ * Sets the string that the offsets of the raw headers refer to.
+ *
+ * Must be called before addRaw(), and the string must not be modified until clearAll() is called.
+ * Appending to the string is allowed.
+ */
+void HTTPHeaders::setRawSource(const std::string * source) {
+  _rawSource = source;
+}
+
+/**
+ * Adds a received header by its location in the raw source.
+ *
+ * Headers that have been received multiple times are all kept, but lookups return the last one.
+ */
+void HTTPHeaders::addRaw(size_t nameOffset, size_t nameLength, size_t valueOffset, size_t valueLength) {
+  Entry entry;
+  entry.nameOffset = nameOffset;
+  entry.nameLength = nameLength;
+  entry.valueOffset = valueOffset;
+  entry.valueLength = valueLength;
+  entry.id = identifyHeaderName(_rawSource->data() + nameOffset, nameLength);
+  entry.raw = true;
+  entry.header = NULL;
+  if (entry.id != HEADER_UNKNOWN) {
+    _index[entry.id] = _entries.size();
+  }
+  _entries.push_back(entry);
+}
+
+const char * HTTPHeaders::entryData(const Entry &entry) {
+  return entry.raw ? _rawSource->data() : _arena.data();
+}
+
+bool HTTPHeaders::entryNameEquals(const Entry &entry, const char * name, size_t nameLength, HTTPHeaderId id) {
+  if (id != HEADER_UNKNOWN) {
+    return entry.id == id;
+  }
+  return entry.id == HEADER_UNKNOWN && headerNameEquals(entryData(entry) + entry.nameOffset, entry.nameLength, name, nameLength);
+}
+
+void HTTPHeaders::serializeEntry(std::string &buffer, const Entry &entry) {
+  const char * data = entryData(entry);
+  buffer.append(data + entry.nameOffset, entry.nameLength);
+  buffer.append(": ", 2);
+  buffer.append(data + entry.valueOffset, entry.valueLength);
+  buffer.append("\r\n", 2);
+}
+
+/**
+ * Returns true if other contains a header with the name of the entry
+ */
+bool HTTPHeaders::containsName(HTTPHeaders &other, const Entry &entry) {
+  return other.find(entryData(entry) + entry.nameOffset, entry.nameLength, (HTTPHeaderId)entry.id) >= 0;
+}
+
+/**
+ * Returns the index of the last entry with the given name, or -1
+ */
+int HTTPHeaders::find(const char * name, size_t nameLength, HTTPHeaderId id) {
+  if (id != HEADER_UNKNOWN) {
+    return _index[id];
+  }
+  for(int i = _entries.size() - 1; i >= 0; i--) {
+    if (entryNameEquals(_entries[i], name, nameLength, id)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int HTTPHeaders::find(std::string const &name) {
+  return find(name.data(), name.length(), identifyHeaderName(name.data(), name.length()));
+}
+
+/**
+ * Replaces the first entry of the name and removes the others, or appends a new entry
+ */
+void HTTPHeaders::setEntry(const char * name, size_t nameLength, const char * value, size_t valueLength, HTTPHeader * header) {
+  HTTPHeaderId id = identifyHeaderName(name, nameLength);
+
+  // The name is stored normalized, like HTTPHeader does it
+  Entry entry;
+  entry.nameOffset = _arena.size();
+  entry.nameLength = nameLength;
+  _arena.append(name, nameLength);
+  normalizeHeaderName(&_arena[entry.nameOffset], nameLength);
+  entry.valueOffset = _arena.size();
+  entry.valueLength = valueLength;
+  _arena.append(value, valueLength);
+  entry.id = id;
+  entry.raw = false;
+  entry.header = header;
+
+  // The first entry of the name is replaced, so that the order of the headers is kept
+  bool replaced = false;
+  size_t i = 0;
+  while (i < _entries.size()) {
+    if (!entryNameEquals(_entries[i], name, nameLength, id)) {
+      i++;
+    } else if (!replaced) {
+      delete _entries[i].header;
+      _entries[i] = entry;
+      replaced = true;
+      i++;
+    } else {
+      delete _entries[i].header;
+      _entries.erase(_entries.begin() + i);
+    }
+  }
+  if (!replaced) {
+    _entries.push_back(entry);
+  }
+  updateIndex();
+  updateSerialized();
+}
+
+/**
+ * Creates the HTTPHeader instance of the entry, if it does not exist yet
+ */
+HTTPHeader * HTTPHeaders::materialize(Entry &entry) {
+  if (entry.header == NULL) {
+    const char * data = entryData(entry);
+    entry.header = new HTTPHeader(
+      std::string(data + entry.nameOffset, entry.nameLength),
+      std::string(data + entry.valueOffset, entry.valueLength)
+    );
+  }
+  return entry.header;
+}
+
+void HTTPHeaders::updateIndex() {
+  for(int i = 0; i < HEADER_COUNT; i++) {
+    _index[i] = -1;
+  }
+  for(size_t i = 0; i < _entries.size(); i++) {
+    if (_entries[i].id != HEADER_UNKNOWN) {
+      _index[_entries[i].id] = i;
+    }
+  }
+}
+
+void HTTPHeaders::updateSerialized() {
+  if (_keepSerialized) {
+    _serialized.clear();
+    serialize(_serialized);
   }
-  _headers->clear();
 }
 
 } /* namespace httpsserver */
@@ -12,8 +12,29 @@
 
 namespace httpsserver {
 
+class HTTPConnection;
+
 /**
- * \brief Groups and manages a set of HTTPHeader instances
+ * \brief Manages the headers of a request or response
+ *
+ * The headers are stored in a flat table: Names and values are copied into a
+ * single byte arena, and the table only holds their offsets. Headers of
+ * incoming requests are not copied at all. The connection records where name
+ * and value are located in its request buffer.
+ *
+ * Frequently used headers (see HTTPHeaderId) are identified when they are
+ * added, so looking them up does not require to compare names.
+ *
+ * The storage is kept by clearAll(), so an instance that is reused for each
+ * request does not allocate memory once it has grown to the required size.
+ *
+ * get() and getAll() return HTTPHeader instances for compatibility. They are
+ * only created when these functions are called, and they stay valid until the
+ * header is replaced or clearAll() is called.
+ *
+ * Headers that are sent with every response, like the default headers of the
+ * server, can keep their serialized form (see keepSerialized()). It is then
+ * written as a single block instead of being serialized for each response.
  */
 class HTTPHeaders {
 public:
@@ -22,14 +43,71 @@ public:
 
   HTTPHeader * get(std::string const &name);
   std::string getValue(std::string const &name);
+  std::string getValue(HTTPHeaderId id);
+  bool getValue(HTTPHeaderId id, const char ** value, size_t * length);
+  bool isSet(HTTPHeaderId id);
+  bool isSet(std::string const &name);
+
   void set(HTTPHeader * header);
+  void set(std::string const &name, std::string const &value);
 
   std::vector<HTTPHeader *> * getAll();
+  size_t getCount();
+  void serialize(std::string &buffer);
+  void serializeWithout(std::string &buffer, HTTPHeaders &excluded);
+  void keepSerialized();
 
   void clearAll();
 
 private:
-  std::vector<HTTPHeader*> * _headers;
+  friend class HTTPConnection;
+
+  // A single header. Name and value are located either in _arena or in _rawSource
+  struct Entry {
+    uint32_t nameOffset;
+    uint32_t valueOffset;
+    uint32_t nameLength;
+    uint32_t valueLength;
+    // HTTPHeaderId of the name
+    uint8_t id;
+    // True if the offsets refer to _rawSource
+    bool raw;
+    // Instance returned by get() or getAll(), NULL if it has not been requested
+    HTTPHeader * header;
+  };
+
+  void setRawSource(const std::string * source);
+  void addRaw(size_t nameOffset, size_t nameLength, size_t valueOffset, size_t valueLength);
+
+  const char * entryData(const Entry &entry);
+  bool entryNameEquals(const Entry &entry, const char * name, size_t nameLength, HTTPHeaderId id);
+  bool containsName(HTTPHeaders &other, const Entry &entry);
+  void serializeEntry(std::string &buffer, const Entry &entry);
+  int find(const char * name, size_t nameLength, HTTPHeaderId id);
+  int find(std::string const &name);
+  void setEntry(const char * name, size_t nameLength, const char * value, size_t valueLength, HTTPHeader * header);
+  HTTPHeader * materialize(Entry &entry);
+  void updateIndex();
+  void updateSerialized();
+
+  // Header table, in the order in which the headers have been added
+  std::vector<Entry> _entries;
+
+  // Names and values of headers that have been set
+  std::string _arena;
+
+  // Index of the last entry of each HTTPHeaderId in _entries, or -1
+  int16_t _index[HEADER_COUNT];
+
+  // Request data that the offsets of raw entries refer to
+  const std::string * _rawSource;
+
+  // Returned by getAll()
+  std::vector<HTTPHeader *> _all;
+
+  // All headers as "Name: value\r\n" lines, only maintained if _keepSerialized is set
+  std::string _serialized;
+  bool _keepSerialized;
 };
 
 } /* namespace httpsserver */
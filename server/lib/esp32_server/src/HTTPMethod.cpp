@@ -0,0 +1,54 @@
+#include "HTTPMethod.hpp"
+
+namespace httpsserver {
+
+namespace {
+
+struct MethodName {
+  HTTPMethodId id;
+  const char * name;
+  size_t length;
+};
+
+const MethodName METHOD_NAMES[] = {
+  {METHOD_GET,     "GET",     3},
+  {METHOD_HEAD,    "HEAD",    4},
+  {METHOD_POST,    "POST",    4},
+  {METHOD_PUT,     "PUT",     3},
+  {METHOD_DELETE,  "DELETE",  6},
+  {METHOD_PATCH,   "PATCH",   5},
+  {METHOD_OPTIONS, "OPTIONS", 7},
+  {METHOD_CONNECT, "CONNECT", 7},
+  {METHOD_TRACE,   "TRACE",   5}
+};
+
+} /* namespace */
+
+HTTPMethodId identifyMethod(const char * name, size_t nameLength) {
+  // Most requests are GET or POST, which are at the start of the table
+  for(size_t i = 0; i < sizeof(METHOD_NAMES) / sizeof(METHOD_NAMES[0]); i++) {
+    if (METHOD_NAMES[i].length == nameLength && memcmp(METHOD_NAMES[i].name, name, nameLength) == 0) {
+      return METHOD_NAMES[i].id;
+    }
+  }
+  return METHOD_UNKNOWN;
+}
+
+HTTPMethodId identifyMethod(std::string const &name) {
+  return identifyMethod(name.data(), name.size());
+}
+
+std::string methodMaskToString(uint16_t methods) {
+  std::string names;
+  for(size_t i = 0; i < sizeof(METHOD_NAMES) / sizeof(METHOD_NAMES[0]); i++) {
+    if ((methods & METHOD_NAMES[i].id) != 0) {
+      if (!names.empty()) {
+        names += '|';
+      }
+      names += METHOD_NAMES[i].name;
+    }
+  }
+  return names;
+}
+
+} /* namespace httpsserver */
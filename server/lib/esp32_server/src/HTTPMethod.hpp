@@ -0,0 +1,44 @@
+#ifndef SRC_HTTPMETHOD_HPP_
+#define SRC_HTTPMETHOD_HPP_
+
+#include <Arduino.h>
+#include <string>
+
+namespace httpsserver {
+
+/**
+ * \brief Request methods that are identified when the request line is parsed
+ *
+ * Each method is a single bit, so a ResourceNode can be registered for several
+ * methods at once, like METHOD_GET | METHOD_POST. Other methods are identified
+ * as METHOD_UNKNOWN and are compared by name.
+ */
+enum HTTPMethodId {
+  METHOD_UNKNOWN = 0,
+  METHOD_GET     = 1 << 0,
+  METHOD_HEAD    = 1 << 1,
+  METHOD_POST    = 1 << 2,
+  METHOD_PUT     = 1 << 3,
+  METHOD_DELETE  = 1 << 4,
+  METHOD_PATCH   = 1 << 5,
+  METHOD_OPTIONS = 1 << 6,
+  METHOD_CONNECT = 1 << 7,
+  METHOD_TRACE   = 1 << 8,
+  // All methods above, not a method itself
+  METHOD_ANY     = (1 << 9) - 1
+};
+
+/**
+ * \brief Returns the id of a method name, or METHOD_UNKNOWN. Method names are case-sensitive
+ */
+HTTPMethodId identifyMethod(const char * name, size_t nameLength);
+HTTPMethodId identifyMethod(std::string const &name);
+
+/**
+ * \brief Returns the names of the methods in a mask, separated by "|", like "GET|HEAD"
+ */
+std::string methodMaskToString(uint16_t methods);
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPMETHOD_HPP_ */
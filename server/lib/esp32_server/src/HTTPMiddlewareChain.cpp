@@ -0,0 +1,57 @@
+#include "HTTPMiddlewareChain.hpp"
+
+#include "HTTPConnection.hpp"
+
+namespace httpsserver {
+
+HTTPMiddlewareChain::HTTPMiddlewareChain() {
+  compile(std::vector<const HTTPSMiddlewareFunction*>());
+}
+
+HTTPMiddlewareChain::~HTTPMiddlewareChain() {
+
+}
+
+/**
+ * Replaces the chain by the validation of the node followed by the middleware functions
+ */
+void HTTPMiddlewareChain::compile(std::vector<const HTTPSMiddlewareFunction*> const &middleware) {
+  _functions.clear();
+  _functions.reserve(middleware.size() + 1);
+  _functions.push_back(&validationMiddleware);
+  _functions.insert(_functions.end(), middleware.begin(), middleware.end());
+}
+
+/**
+ * Returns the number of functions in the chain, without the handler
+ */
+size_t HTTPMiddlewareChain::size() const {
+  return _functions.size();
+}
+
+/**
+ * Calls the chain for a request. The handler is called if every middleware function calls next.
+ */
+void HTTPMiddlewareChain::run(HTTPRequest * req, HTTPResponse * res, Handler const &handler) const {
+  Invocation invocation = {this, req, res, &handler};
+  call(&invocation, 0);
+}
+
+void HTTPMiddlewareChain::Next::operator()() const {
+  call(invocation, index);
+}
+
+/**
+ * Calls the function at index, or the handler at the end of the chain
+ */
+void HTTPMiddlewareChain::call(Invocation * invocation, size_t index) {
+  const std::vector<const HTTPSMiddlewareFunction*> &functions = invocation->chain->_functions;
+  if (index < functions.size()) {
+    Next next = {invocation, index + 1};
+    functions[index](invocation->req, invocation->res, std::function<void()>(next));
+  } else {
+    (*invocation->handler)(invocation->req, invocation->res);
+  }
+}
+
+} /* namespace httpsserver */
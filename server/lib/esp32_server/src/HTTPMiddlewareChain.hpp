@@ -0,0 +1,64 @@
+#ifndef SRC_HTTPMIDDLEWARECHAIN_HPP_
+#define SRC_HTTPMIDDLEWARECHAIN_HPP_
+
+#include <functional>
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <vector>
+
+#include "HTTPRequest.hpp"
+#include "HTTPResponse.hpp"
+#include "HTTPMiddlewareFunction.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief The middleware functions that are called for a request, used by ResourceResolver and HTTPConnection
+ *
+ * The chain is compiled into a flat array when the middleware of the server
+ * changes, and the connection walks it by index for each request. The "next"
+ * function that is passed to each middleware only refers to the position in the
+ * chain. It is small enough for std::function to store it without allocating
+ * memory, so calling the chain does not use the heap.
+ *
+ * The first function of the chain runs the validators of the node (see
+ * HTTPNode::addPathParamValidator()), the last one is the handler.
+ */
+class HTTPMiddlewareChain {
+public:
+  /** The end of the chain, which handles the request */
+  typedef std::function<void(HTTPRequest * req, HTTPResponse * res)> Handler;
+
+  HTTPMiddlewareChain();
+  virtual ~HTTPMiddlewareChain();
+
+  void compile(std::vector<const HTTPSMiddlewareFunction*> const &middleware);
+  size_t size() const;
+  void run(HTTPRequest * req, HTTPResponse * res, Handler const &handler) const;
+
+private:
+  // State of a single run of the chain, which lives on the stack of run()
+  struct Invocation {
+    const HTTPMiddlewareChain * chain;
+    HTTPRequest * req;
+    HTTPResponse * res;
+    const Handler * handler;
+  };
+
+  // The "next" function for the middleware at index - 1
+  struct Next {
+    Invocation * invocation;
+    size_t index;
+    void operator()() const;
+  };
+
+  static void call(Invocation * invocation, size_t index);
+
+  std::vector<const HTTPSMiddlewareFunction*> _functions;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPMIDDLEWARECHAIN_HPP_ */
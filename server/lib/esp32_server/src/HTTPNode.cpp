@@ -6,7 +6,8 @@ namespace httpsserver {
   HTTPNode::HTTPNode(std::string const &path, const HTTPNodeType nodeType, std::string const &tag):
     _path(path),
     _tag(tag),
-    _nodeType(nodeType) {
+    _nodeType(nodeType),
+    _pathPrefix(false) {
 
     // Count the parameters and store the indices
     size_t idx = 0;
@@ -43,6 +44,10 @@ namespace httpsserver {
     return _pathParamIdx.size();
   }
 
+  bool HTTPNode::isPathPrefix() {
+    return _pathPrefix;
+  }
+
   void HTTPNode::addPathParamValidator(size_t paramIdx, const HTTPValidationFunction * validator) {
     _validators.push_back(new HTTPValidator(paramIdx, validator));
 
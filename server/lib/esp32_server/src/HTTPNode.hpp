@@ -46,6 +46,7 @@ public:
   bool hasPathParameter();
   size_t getPathParamCount();
   ssize_t getParamIdx(size_t);
+  bool isPathPrefix();
 
   std::vector<HTTPValidator*> * getValidators();
 
@@ -60,6 +61,13 @@ public:
    */
   void addPathParamValidator(size_t paramIdx, const HTTPValidationFunction * validator);
 
+protected:
+  /**
+   * If set, the node also handles every path below its own path, like a directory. Used by
+   * StaticFileNode
+   */
+  bool _pathPrefix;
+
 private:
   std::vector<size_t> _pathParamIdx;
   std::vector<HTTPValidator*> _validators;
@@ -1,27 +1,52 @@
 #include "HTTPRequest.hpp"
 
+#include <algorithm>
+
 namespace httpsserver {
 
 HTTPRequest::HTTPRequest(
     ConnectionContext * con,
     HTTPHeaders * headers,
     HTTPNode * resolvedNode,
-    std::string method,
+    std::string const &method,
+    HTTPMethodId methodId,
     ResourceParameters * params,
-    std::string requestString):
+    std::string const &requestString):
   _con(con),
   _headers(headers),
   _resolvedNode(resolvedNode),
   _method(method),
+  _methodId(methodId),
   _params(params),
   _requestString(requestString) {
 
-  HTTPHeader * contentLength = headers->get("Content-Length");
-  if (contentLength == NULL) {
+  _chunked = false;
+  _chunkState = CHUNK_DONE;
+  _chunkSize = 0;
+  _chunkLineLength = 0;
+  _chunkExtension = false;
+  _chunkedBodyLength = 0;
+
+  // Transfer-Encoding takes precedence over Content-Length (RFC 7230, 3.3.3). The connection only
+  // accepts requests whose Transfer-Encoding is chunked, see HTTPConnection::checkTransferEncoding()
+  if (headers->isSet(HEADER_TRANSFER_ENCODING)) {
+    _chunked = true;
+    _chunkState = CHUNK_SIZE;
     _remainingContent = 0;
     _contentLengthSet = false;
+    return;
+  }
+
+  const char * contentLength;
+  size_t contentLengthLength;
+  if (!headers->getValue(HEADER_CONTENT_LENGTH, &contentLength, &contentLengthLength)) {
+    _remainingContent = 0;
+    // A request on a keep-alive connection has no body without Content-Length. Otherwise, pipelined
+    // requests following this one would be consumed as request body. The same applies to upgrade
+    // requests, as the data after the request belongs to the new protocol (e.g. websocket frames).
+    _contentLengthSet = con->isKeepAlive() || headers->isSet(HEADER_UPGRADE);
   } else {
-    _remainingContent = parseInt(contentLength->_value);
+    _remainingContent = parseInt(std::string(contentLength, contentLengthLength));
     _contentLengthSet = true;
   }
 
@@ -41,16 +66,11 @@ HTTPHeaders * HTTPRequest::getHTTPHeaders() {
 }
 
 std::string HTTPRequest::getHeader(std::string const &name) {
-  HTTPHeader * h = _headers->get(name);
-  if (h != NULL) {
-    return h->_value;
-  } else {
-    return std::string();
-  }
+  return _headers->getValue(name);
 }
 
 void HTTPRequest::setHeader(std::string const &name, std::string const &value) {
-  _headers->set(new HTTPHeader(name, value));
+  _headers->set(name, value);
 }
 
 HTTPNode * HTTPRequest::getResolvedNode() {
@@ -62,6 +82,29 @@ IPAddress HTTPRequest::getClientIP() {
 }
 
 size_t HTTPRequest::readBytes(byte * buffer, size_t length) {
+  if (_chunked) {
+    // Decode the chunked body. Framing is skipped until data is available or the body is done
+    size_t bytesRead = 0;
+    while (bytesRead < length && _chunkState != CHUNK_DONE) {
+      if (_chunkState == CHUNK_DATA) {
+        size_t didRead = _con->readBuffer(buffer + bytesRead, std::min(length - bytesRead, _remainingContent));
+        if (didRead == 0) {
+          break;
+        }
+        bytesRead += didRead;
+        _remainingContent -= didRead;
+        if (_remainingContent == 0) {
+          _chunkState = CHUNK_DATA_END;
+        }
+      } else if (!readChunkFraming()) {
+        break;
+      }
+    }
+    if (bytesRead < length && _chunkState != CHUNK_DONE && _con->isInputClosed()) {
+      abortRequestBody("Chunked body incomplete");
+    }
+    return bytesRead;
+  }
 
   // Limit reading to content length
   if (_contentLengthSet && length > _remainingContent) {
@@ -75,17 +118,121 @@ size_t HTTPRequest::readBytes(byte * buffer, size_t length) {
 
   if (_contentLengthSet) {
     _remainingContent -= bytesRead;
+    if (bytesRead == 0 && _remainingContent > 0 && _con->isInputClosed()) {
+      abortRequestBody("Request body incomplete");
+    }
   }
 
   return bytesRead;
 }
 
+/**
+ * Processes chunk framing (size line, line break after the data, or trailer) from the receive
+ * buffer, up to the end of the current line.
+ *
+ * Returns false if no data is available at the moment.
+ */
+bool HTTPRequest::readChunkFraming() {
+  const byte * data;
+  size_t dataLength = _con->peekBuffer(&data);
+  if (dataLength == 0) {
+    return false;
+  }
+
+  // Only the current line is consumed, the data behind it belongs to the next chunk or request
+  const byte * lineEnd = (const byte*)memchr(data, '\n', dataLength);
+  size_t length = (lineEnd != NULL ? lineEnd - data : dataLength);
+  size_t lineLength = 0;
+  for(size_t i = 0; i < length; i++) {
+    if (data[i] != '\r') {
+      lineLength++;
+    }
+  }
+  _chunkLineLength += lineLength;
+  if (_chunkLineLength > HTTPS_REQUEST_MAX_HEADER_LENGTH) {
+    abortRequestBody("Chunk framing line too long");
+    return true;
+  }
+
+  switch(_chunkState) {
+  case CHUNK_SIZE:
+    for(size_t i = 0; i < length && !_chunkExtension; i++) {
+      byte c = data[i];
+      if (c == ';') {
+        // Chunk extensions are ignored
+        _chunkExtension = true;
+      } else if (c != '\r') {
+        int digit = (c >= '0' && c <= '9') ? c - '0' :
+          ((c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+          ((c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1));
+        if (digit < 0) {
+          abortRequestBody("Invalid chunk size");
+          return true;
+        }
+        _chunkSize = _chunkSize * 16 + digit;
+        if (_chunkedBodyLength + _chunkSize > HTTPS_REQUEST_MAX_CHUNKED_BODY_SIZE) {
+          abortRequestBody("Chunked body too large");
+          return true;
+        }
+      }
+    }
+    if (lineEnd != NULL) {
+      if (_chunkLineLength == 0) {
+        abortRequestBody("Missing chunk size");
+        return true;
+      } else if (_chunkSize == 0) {
+        // The last chunk is followed by optional trailer fields, which we ignore
+        _chunkState = CHUNK_TRAILER;
+      } else {
+        _chunkedBodyLength += _chunkSize;
+        _remainingContent = _chunkSize;
+        _chunkState = CHUNK_DATA;
+      }
+      _chunkSize = 0;
+      _chunkExtension = false;
+    }
+    break;
+  case CHUNK_DATA_END:
+    if (lineLength > 0) {
+      abortRequestBody("Missing line break after chunk");
+      return true;
+    }
+    if (lineEnd != NULL) {
+      _chunkState = CHUNK_SIZE;
+    }
+    break;
+  case CHUNK_TRAILER:
+    if (lineEnd != NULL && _chunkLineLength == 0) {
+      _chunkState = CHUNK_DONE;
+    }
+    break;
+  default:;
+  }
+  if (lineEnd != NULL) {
+    _chunkLineLength = 0;
+    length++;
+  }
+  _con->skipBuffer(length);
+  return true;
+}
+
+/**
+ * Stops reading the request body and signals the error to the connection
+ */
+void HTTPRequest::abortRequestBody(const char * reason) {
+  HTTPS_LOGW("%s", reason);
+  _chunkState = CHUNK_DONE;
+  _remainingContent = 0;
+  _con->signalRequestError();
+}
+
 size_t HTTPRequest::readChars(char * buffer, size_t length) {
   return readBytes((byte*)buffer, length);
 }
 
 size_t HTTPRequest::getContentLength() {
-  return _remainingContent;
+  // The length of a chunked body is not known in advance
+  return (_chunked ? 0 : _remainingContent);
 }
 
 std::string HTTPRequest::getRequestString() {
@@ -96,12 +243,22 @@ std::string HTTPRequest::getMethod() {
   return _method;
 }
 
+/**
+ * Returns the method of the request, or METHOD_UNKNOWN if it is none of the methods in
+ * HTTPMethodId. Use getMethod() for the name in that case.
+ */
+HTTPMethodId HTTPRequest::getMethodId() {
+  return _methodId;
+}
+
 std::string HTTPRequest::getTag() {
   return _resolvedNode->_tag;
 }
 
 bool HTTPRequest::requestComplete() {
-  if (_contentLengthSet) {
+  if (_chunked) {
+    return (_chunkState == CHUNK_DONE);
+  } else if (_contentLengthSet) {
     // If we have a content size, rely on it.
     return (_remainingContent == 0);
   } else {
@@ -11,6 +11,7 @@
 #include "HTTPNode.hpp"
 #include "HTTPHeader.hpp"
 #include "HTTPHeaders.hpp"
+#include "HTTPMethod.hpp"
 #include "ResourceParameters.hpp"
 #include "util.hpp"
 
@@ -21,7 +22,8 @@ namespace httpsserver {
  */
 class HTTPRequest {
 public:
-  HTTPRequest(ConnectionContext * con, HTTPHeaders * headers, HTTPNode * resolvedNode, std::string method, ResourceParameters * params, std::string requestString);
+  HTTPRequest(ConnectionContext * con, HTTPHeaders * headers, HTTPNode * resolvedNode, std::string const &method,
+    HTTPMethodId methodId, ResourceParameters * params, std::string const &requestString);
   virtual ~HTTPRequest();
 
   std::string getHeader(std::string const &name);
@@ -29,6 +31,7 @@ public:
   HTTPNode * getResolvedNode();
   std::string getRequestString();
   std::string getMethod();
+  HTTPMethodId getMethodId();
   std::string getTag();
   IPAddress getClientIP();
 
@@ -46,6 +49,8 @@ public:
 
 private:
   std::string decodeBasicAuthToken();
+  bool readChunkFraming();
+  void abortRequestBody(const char * reason);
 
   ConnectionContext * _con;
 
@@ -53,7 +58,9 @@ private:
 
   HTTPNode * _resolvedNode;
 
-  std::string _method;
+  // The method name is owned by the connection, which keeps it until the next request
+  std::string const &_method;
+  HTTPMethodId _methodId;
 
   ResourceParameters * _params;
 
@@ -61,6 +68,21 @@ private:
 
   bool _contentLengthSet;
   size_t _remainingContent;
+
+  // Decoding of bodies with Transfer-Encoding: chunked. While in CHUNK_DATA,
+  // _remainingContent contains the bytes that are left in the current chunk.
+  bool _chunked;
+  enum {
+    CHUNK_SIZE,      // Reading the chunk size line
+    CHUNK_DATA,      // Reading chunk data
+    CHUNK_DATA_END,  // Reading the \r\n after the chunk data
+    CHUNK_TRAILER,   // Reading (and ignoring) the trailer fields
+    CHUNK_DONE       // Body is complete (or reading it failed)
+  } _chunkState;
+  size_t _chunkSize;
+  size_t _chunkLineLength;
+  bool _chunkExtension;
+  size_t _chunkedBodyLength;
 };
 
 } /* namespace httpsserver */
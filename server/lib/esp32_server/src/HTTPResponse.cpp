@@ -7,18 +7,53 @@ namespace httpsserver {
 
 HTTPResponse::HTTPResponse(ConnectionContext * con):
   _con(con) {
+  _headers = new HTTPHeaders();
+  _ownsHeaders = true;
+  _defaultHeaders = NULL;
+  init();
+}
 
+/**
+ * Creates a response that uses the given header storage, which must be empty. It is cleared again
+ * when the response is destroyed, so a connection can reuse it for every request.
+ *
+ * The defaultHeaders are written along with the headers of the response, except for those that
+ * the response sets itself. They are not modified.
+ */
+HTTPResponse::HTTPResponse(ConnectionContext * con, HTTPHeaders * headers, HTTPHeaders * defaultHeaders):
+  _con(con) {
+  _headers = headers;
+  _ownsHeaders = false;
+  _defaultHeaders = defaultHeaders;
+  init();
+}
+
+void HTTPResponse::init() {
   // Default status code is 200 OK
   _statusCode = 200;
   _statusText = "OK";
   _headerWritten = false;
+  _headPending = false;
   _isError = false;
+  _chunked = false;
+  _fixedLength = false;
+  _remainingLength = 0;
+  _omitBody = false;
+  _recording = NULL;
+  _recordingLimit = 0;
 
-  _responseCacheSize = con->getCacheSize();
+  // Responses that are not cached completely still collect small writes in the cache, so that
+  // they are sent with as few writes to the connection as possible
+  size_t cacheSize = _con->getCacheSize();
+  _staging = (cacheSize == 0);
+  if (_staging) {
+    cacheSize = HTTPS_RESPONSE_STAGING_SIZE;
+  }
   _responseCachePointer = 0;
-  if (_responseCacheSize > 0) {
-    HTTPS_LOGD("Creating buffered response, size: %d", _responseCacheSize);
-    _responseCache = new byte[_responseCacheSize];
+  _responseCacheSize = 0;
+  if (cacheSize > 0) {
+    _responseCache = _con->acquireResponseBuffer(cacheSize, &_responseCacheSize);
+    HTTPS_LOGD("Creating %s response, size: %d", _staging ? "staged" : "buffered", _responseCacheSize);
   } else {
     HTTPS_LOGD("Creating non-buffered response");
     _responseCache = NULL;
@@ -26,10 +61,11 @@ HTTPResponse::HTTPResponse(ConnectionContext * con):
 }
 
 HTTPResponse::~HTTPResponse() {
-  if (_responseCache != NULL) {
-    delete[] _responseCache;
+  releaseCache();
+  _headers->clearAll();
+  if (_ownsHeaders) {
+    delete _headers;
   }
-  _headers.clearAll();
 }
 
 void HTTPResponse::setStatusCode(uint16_t statusCode) {
@@ -49,29 +85,154 @@ std::string HTTPResponse::getStatusText() {
 }
 
 void HTTPResponse::setHeader(std::string const &name, std::string const &value) {
-  _headers.set(new HTTPHeader(name, value));
+  _headers->set(name, value);
 }
 
+/**
+ * Returns the value of a header of the response, or of the default header of that name if the
+ * response does not set it
+ */
 std::string HTTPResponse::getHeader(std::string const &name) {
-  HTTPHeader * h = _headers.get(name);
-  if (h != NULL) {
-    return h->_value;
-  } else {
-    return std::string();
+  if (_defaultHeaders != NULL && !_headers->isSet(name)) {
+    return _defaultHeaders->getValue(name);
   }
+  return _headers->getValue(name);
 }
 
 bool HTTPResponse::isHeaderWritten() {
   return _headerWritten;
 }
 
+/**
+ * Returns true if the response is cached completely to determine its Content-Length
+ */
 bool HTTPResponse::isResponseBuffered() {
-  return _responseCache != NULL;
+  return _responseCache != NULL && !_staging;
+}
+
+/**
+ * Returns true if the response body is sent with Transfer-Encoding: chunked
+ */
+bool HTTPResponse::isChunked() {
+  return _chunked;
+}
+
+/**
+ * Starts streaming the response: The headers are sent immediately, and the body is sent while
+ * it is written instead of caching it to calculate the Content-Length.
+ *
+ * On keep-alive connections with HTTP/1.1 clients, the body is sent with Transfer-Encoding: chunked,
+ * so that the connection can be reused. Otherwise, the connection is closed after the response.
+ * Headers cannot be modified after calling this function.
+ */
+void HTTPResponse::beginStream() {
+  if (!_headerWritten && !_isError) {
+    if (isResponseBuffered() && _con->isChunkedAllowed() && getHeader("Content-Length").empty()) {
+      beginChunked();
+    } else {
+      if (isResponseBuffered()) {
+        setHeader("Connection", "close");
+      }
+      beginStaging();
+    }
+    flush();
+  }
+}
+
+/**
+ * Starts streaming a response whose length is known in advance, like a file. The headers are
+ * sent with Content-Length along with the first data, and the body is sent while it is written.
+ *
+ * Unlike beginStream(), this keeps the connection reusable without chunked encoding. Exactly
+ * contentLength bytes have to be written, more are discarded. If less are written, the connection
+ * is closed after the response.
+ */
+void HTTPResponse::beginStream(size_t contentLength) {
+  if (!_headerWritten && !_isError) {
+    setHeader("Content-Length", intToString(contentLength));
+    if (_con->isKeepAlive() && getHeader("Connection").empty()) {
+      setHeader("Connection", "keep-alive");
+    }
+    _fixedLength = true;
+    // Without body, the response is complete as soon as the headers are sent
+    _remainingLength = (_omitBody ? 0 : contentLength);
+    // On keep-alive connections, the cache may grow, so a large body is sent in fewer writes
+    size_t stagingSize = std::min(contentLength, _con->getMaxCacheSize());
+    if (_responseCache != NULL && stagingSize > _responseCacheSize) {
+      growCache(stagingSize);
+    }
+    beginStaging();
+  }
+}
+
+/**
+ * Returns true if the response started by beginStream(contentLength) has been written completely
+ */
+bool HTTPResponse::isBodyComplete() {
+  return _fixedLength && _remainingLength == 0;
+}
+
+/**
+ * Returns true if the body is not sent, because the request used the HEAD method. Handlers may
+ * skip creating the body then, but should set the same headers as for GET.
+ */
+bool HTTPResponse::isBodyOmitted() {
+  return _omitBody;
+}
+
+/**
+ * Discards everything that is written to the body, for responses to HEAD requests. A buffered
+ * body is still collected, so the Content-Length is the same as for GET.
+ */
+void HTTPResponse::omitBody() {
+  _omitBody = true;
 }
 
 void HTTPResponse::finalize() {
-  if (isResponseBuffered()) {
-    drainBuffer();
+  if (_chunked) {
+    if (_responseCache != NULL) {
+      // Send the remaining data and the last chunk, which is empty, in one write
+      if (_responseCachePointer > 0) {
+        writeChunk(_responseCache, _responseCachePointer, true);
+      } else {
+        ConnectionBufferSegment lastChunk = {(const byte*)"0\r\n\r\n", 5};
+        writeSegments(&lastChunk, 1);
+      }
+    }
+  } else {
+    if (isResponseBuffered()) {
+      // The response is complete, so the cache holds the whole body. Responses that must not
+      // have a body do not get a Content-Length, as it would describe the omitted representation
+      if (_statusCode != 204 && _statusCode != 304) {
+        _headers->set("Content-Length", intToString(_responseCachePointer));
+      }
+      _staging = true;
+    }
+    // Sends the headers if that has not been done yet, also for a response without body
+    printHeader();
+    flush();
+  }
+  releaseCache();
+}
+
+/**
+ * Sends the data that has been written so far, along with the headers if they have not been sent.
+ *
+ * This has no effect while the response is cached to determine its Content-Length, see
+ * beginStream().
+ */
+void HTTPResponse::flush() {
+  if (_chunked) {
+    if (_responseCachePointer > 0) {
+      writeChunk(_responseCache, _responseCachePointer);
+      _responseCachePointer = 0;
+    } else {
+      writeSegments(NULL, 0);
+    }
+  } else if (_headerWritten && !isResponseBuffered()) {
+    ConnectionBufferSegment staged = {_responseCache, _responseCachePointer};
+    writeSegments(&staged, 1);
+    _responseCachePointer = 0;
   }
 }
 
@@ -104,27 +265,37 @@ size_t  HTTPResponse::write(uint8_t b) {
 }
 
 /**
- *  If not already done, writes the header.
+ * If not already done, creates the status line and the headers. They are sent with the next
+ * write to the connection.
  */
 void HTTPResponse::printHeader() {
   if (!_headerWritten) {
     HTTPS_LOGD("Printing headers");
 
-    // Status line, like: "HTTP/1.1 200 OK\r\n"
-    std::string statusLine = "HTTP/1.1 " + intToString(_statusCode) + " " + _statusText + "\r\n";
-    printInternal(statusLine, true);
-
-    // Each header, like: "Host: myEsp32\r\n"
-    std::vector<HTTPHeader *> * headers = _headers.getAll();
-    for(std::vector<HTTPHeader*>::iterator header = headers->begin(); header != headers->end(); ++header) {
-      printInternal((*header)->print()+"\r\n", true);
-    }
-    printInternal("\r\n", true);
+    _head.clear();
+    serializeHead(_head);
+    _head.append("\r\n", 2);
+    _headPending = true;
 
     _headerWritten=true;
   }
 }
 
+/**
+ * Appends the status line and the headers to the buffer, without the empty line that ends them
+ */
+void HTTPResponse::serializeHead(std::string &buffer) {
+  // Status line, like: "HTTP/1.1 200 OK\r\n"
+  buffer += "HTTP/1.1 " + intToString(_statusCode) + " " + _statusText + "\r\n";
+
+  // Each header, like: "Host: myEsp32\r\n".
+  // The default headers come first, the ones that the response overrides are skipped.
+  if (_defaultHeaders != NULL) {
+    _defaultHeaders->serializeWithout(buffer, *_headers);
+  }
+  _headers->serialize(buffer);
+}
+
 /**
  * This method can be called to cancel the ongoing transmission and send the error page (if possible)
  */
@@ -132,57 +303,288 @@ void HTTPResponse::error() {
   _con->signalRequestError();
 }
 
-void HTTPResponse::printInternal(const std::string &str, bool skipBuffer) {
-  writeBytesInternal((uint8_t*)str.c_str(), str.length(), skipBuffer);
-}
+size_t HTTPResponse::writeBytesInternal(const void * data, int length) {
+  if (_isError || length < 0) {
+    return 0;
+  }
+  if (_omitBody && (_chunked || !isResponseBuffered())) {
+    // The headers are final, so the body does not need to be counted anymore
+    return length;
+  }
+  if (_fixedLength) {
+    if ((size_t)length > _remainingLength) {
+      HTTPS_LOGW("Discarding %d bytes beyond the Content-Length", length - (int)_remainingLength);
+      length = _remainingLength;
+    }
+    _remainingLength -= length;
+  }
+  if (_recording != NULL) {
+    if (_recording->body.size() + (size_t)length <= _recordingLimit) {
+      _recording->body.append((const char*)data, length);
+    } else {
+      HTTPS_LOGD("Response is too large for the handler cache");
+      _recording = NULL;
+    }
+  }
+  if (isResponseBuffered() && !_chunked) {
+    // We are buffering ...
+    if((size_t)length <= _responseCacheSize - _responseCachePointer || growCache(_responseCachePointer + length)) {
+      // ... and there is space left in the buffer -> Write to buffer
+      memcpy(_responseCache + _responseCachePointer, data, length);
+      _responseCachePointer += length;
+      return length;
+    }
+    // .., and the buffer is too small and cannot grow anymore. This is the point where we switch from
+    // caching to streaming. If the length of the response is not known, we use chunks
+    // to keep the connection reusable. Otherwise, or if the client does not support chunks
+    // (HTTP/1.0), the connection has to be closed.
+    if (!_headerWritten && _con->isChunkedAllowed() && getHeader("Content-Length").empty()) {
+      beginChunked();
+    } else {
+      if (!_headerWritten) {
+        setHeader("Connection", "close");
+      }
+      beginStaging();
+    }
+  }
 
-size_t HTTPResponse::writeBytesInternal(const void * data, int length, bool skipBuffer) {
-  if (!_isError) {
-    if (isResponseBuffered() && !skipBuffer) {
-      // We are buffering ...
-      if(length <= _responseCacheSize - _responseCachePointer) {
-        // ... and there is space left in the buffer -> Write to buffer
-        size_t end = _responseCachePointer + length;
-        size_t i = 0;
-        while(_responseCachePointer < end) {
-          _responseCache[_responseCachePointer++] = ((byte*)data)[i++];
-        }
-        // Returning skips the SSL_write below
-        return length;
-      } else {
-        // .., and the buffer is too small. This is the point where we switch from
-        // caching to streaming
-        if (!_headerWritten) {
-          setHeader("Connection", "close");
-        }
-        drainBuffer(true);
+  if (_chunked) {
+    // Fill the cache and send it as chunk whenever it is full. Large blocks are sent directly.
+    const byte * bytes = (const byte*)data;
+    size_t remaining = length;
+    while (remaining > 0) {
+      if (_responseCachePointer == 0 && remaining >= _responseCacheSize) {
+        writeChunk(bytes, remaining);
+        break;
+      }
+      size_t copyLength = std::min(remaining, _responseCacheSize - _responseCachePointer);
+      memcpy(_responseCache + _responseCachePointer, bytes, copyLength);
+      _responseCachePointer += copyLength;
+      bytes += copyLength;
+      remaining -= copyLength;
+      if (_responseCachePointer == _responseCacheSize) {
+        writeChunk(_responseCache, _responseCachePointer);
+        _responseCachePointer = 0;
       }
     }
+    return length;
+  }
 
-    return _con->writeBuffer((byte*)data, length);
-  } else {
-    return 0;
+  // Staging: Fill the cache and send it whenever it is full, so that each write to the connection
+  // (and each TLS record) is as large as the cache. Blocks that are larger than the cache are sent
+  // directly, together with the staged data.
+  if (_responseCache == NULL || (size_t)length >= _responseCacheSize) {
+    ConnectionBufferSegment segments[2] = {
+      {_responseCache, _responseCachePointer},
+      {(const byte*)data, (size_t)length}
+    };
+    _responseCachePointer = 0;
+    return writeSegments(segments, 2) ? length : 0;
   }
+  const byte * bytes = (const byte*)data;
+  size_t remaining = length;
+  while (remaining > 0) {
+    size_t copyLength = std::min(remaining, _responseCacheSize - _responseCachePointer);
+    memcpy(_responseCache + _responseCachePointer, bytes, copyLength);
+    _responseCachePointer += copyLength;
+    bytes += copyLength;
+    remaining -= copyLength;
+    if (_responseCachePointer == _responseCacheSize) {
+      ConnectionBufferSegment staged = {_responseCache, _responseCachePointer};
+      _responseCachePointer = 0;
+      if (!writeSegments(&staged, 1)) {
+        return 0;
+      }
+    }
+  }
+  return length;
 }
 
-void HTTPResponse::drainBuffer(bool onOverflow) {
-  if (!_headerWritten) {
-    if (_responseCache != NULL && !onOverflow) {
-      _headers.set(new HTTPHeader("Content-Length", intToString(_responseCachePointer)));
-    }
-    printHeader();
+/**
+ * Replaces the cache by a larger one that holds at least size bytes, keeping its content.
+ *
+ * Returns false if size exceeds the maximum cache size of the connection.
+ */
+bool HTTPResponse::growCache(size_t size) {
+  if (size > _con->getMaxCacheSize()) {
+    return false;
   }
+  size_t newSize;
+  byte * newCache = _con->acquireResponseBuffer(size, &newSize);
+  HTTPS_LOGD("Growing response cache to %d bytes", newSize);
+  memcpy(newCache, _responseCache, _responseCachePointer);
+  _con->releaseResponseBuffer(_responseCache, _responseCacheSize);
+  _responseCache = newCache;
+  _responseCacheSize = newSize;
+  return true;
+}
 
+void HTTPResponse::releaseCache() {
   if (_responseCache != NULL) {
-    HTTPS_LOGD("Draining response buffer");
-    // Check for 0 as it may be an overflow reaction without any data that has been written earlier
-    if(_responseCachePointer > 0) {
-      // FIXME: Return value?
-      _con->writeBuffer((byte*)_responseCache, _responseCachePointer);
-    }
-    delete[] _responseCache;
+    _con->releaseResponseBuffer(_responseCache, _responseCacheSize);
     _responseCache = NULL;
   }
 }
 
+/**
+ * Switches a buffered response to Transfer-Encoding: chunked and creates the headers. The data
+ * that has been cached so far is kept and sent with the first chunk.
+ */
+void HTTPResponse::beginChunked() {
+  HTTPS_LOGD("Switching to chunked response");
+  _chunked = true;
+  setHeader("Transfer-Encoding", "chunked");
+  if (getHeader("Connection").empty()) {
+    setHeader("Connection", "keep-alive");
+  }
+  printHeader();
+}
+
+/**
+ * Switches a buffered response to staging, where the cache only collects writes until it is full.
+ * The data that has been cached so far is kept.
+ */
+void HTTPResponse::beginStaging() {
+  printHeader();
+  _staging = true;
+}
+
+/**
+ * Sends a single chunk of the response body, and the last chunk if requested. Must not be called
+ * with length 0, as this would mark the end of the body.
+ */
+void HTTPResponse::writeChunk(const byte * data, size_t length, bool last) {
+  char chunkHeader[12];
+  int chunkHeaderLength = snprintf(chunkHeader, sizeof(chunkHeader), "%x\r\n", (unsigned int)length);
+  ConnectionBufferSegment segments[3] = {
+    {(const byte*)chunkHeader, (size_t)chunkHeaderLength},
+    {data, length},
+    {(const byte*)"\r\n0\r\n\r\n", last ? (size_t)7 : (size_t)2}
+  };
+  writeSegments(segments, 3);
+}
+
+/**
+ * Writes the segments to the connection with a single call, preceded by the headers if they have
+ * not been sent yet. Empty segments are skipped. Returns true if everything has been written.
+ */
+bool HTTPResponse::writeSegments(const ConnectionBufferSegment * segments, size_t count) {
+  if (_isError) {
+    return false;
+  }
+  ConnectionBufferSegment all[4];
+  size_t n = 0;
+  size_t expected = 0;
+  if (_headPending) {
+    all[n].data = (const byte*)_head.data();
+    all[n].length = _head.length();
+    expected += all[n++].length;
+    _headPending = false;
+  }
+  // A response without body only sends its head, and data that has been buffered before the
+  // headers were final is dropped here
+  for(size_t i = 0; i < count && n < 4 && !_omitBody; i++) {
+    if (segments[i].length > 0) {
+      all[n] = segments[i];
+      expected += all[n++].length;
+    }
+  }
+  if (n == 0) {
+    return true;
+  }
+  return _con->writeBuffers(all, n) == expected;
+}
+
+/**
+ * Starts to copy everything that is written to the response into recording, up to limit bytes.
+ * Must be called right before the handler, so the headers that have been set so far (by the
+ * middleware) can be told apart from those of the handler.
+ */
+void HTTPResponse::startRecording(HTTPHandlerCache::Response * recording, size_t limit) {
+  _recording = recording;
+  _recordingLimit = limit;
+  _recordingBaseHeaders.assign("\r\n", 2);
+  _headers->serialize(_recordingBaseHeaders);
+}
+
+/**
+ * Completes the recording with the status and the headers that the handler has set. Headers that
+ * have been set by the middleware or are default headers may differ for each request, and are
+ * taken from the response that replays the recording. The headers that depend on the connection
+ * (Connection, Content-Length, Transfer-Encoding) are left out as well, they are added by replay().
+ *
+ * Returns false if the response must not be cached: It is not a complete 200 response, or it has
+ * become too large.
+ */
+bool HTTPResponse::finishRecording() {
+  HTTPHandlerCache::Response * recording = _recording;
+  _recording = NULL;
+  if (recording == NULL || _isError || _statusCode != 200 || (_fixedLength && _remainingLength > 0)) {
+    return false;
+  }
+  recording->statusCode = _statusCode;
+  recording->statusText = _statusText;
+  // Each line is compared with the lines before the handler, including the line break in front
+  std::string headers("\r\n", 2);
+  _headers->serialize(headers);
+  size_t pos = 2;
+  while (pos < headers.size()) {
+    size_t end = headers.find("\r\n", pos);
+    end = (end == std::string::npos ? headers.size() : end + 2);
+    size_t colon = headers.find(':', pos);
+    size_t nameLength = (colon < end ? colon - pos : 0);
+    const char * name = headers.data() + pos;
+    // A line that has been there before the handler has been set by the middleware
+    bool handlerHeader = _recordingBaseHeaders.find(headers.data() + pos - 2, 0, end - pos + 2) == std::string::npos;
+    if (handlerHeader && !(headerNameEquals(name, nameLength, "Connection", 10) ||
+        headerNameEquals(name, nameLength, "Content-Length", 14) ||
+        headerNameEquals(name, nameLength, "Transfer-Encoding", 17))) {
+      recording->headers.append(headers, pos, end - pos);
+    }
+    pos = end;
+  }
+  return recording->statusText.size() + recording->headers.size() + recording->body.size() <= _recordingLimit;
+}
+
+/**
+ * Sends a response from the handler cache with a single write, instead of anything that has been
+ * written to this response. The recorded headers are applied on top of the headers of this response,
+ * like the handler did when it was called, so headers of the middleware and default headers are
+ * those of the current request.
+ */
+void HTTPResponse::replay(const HTTPHandlerCache::Response &response) {
+  if (_headerWritten || _isError) {
+    return;
+  }
+  _statusCode = response.statusCode;
+  _statusText = response.statusText;
+  size_t pos = 0;
+  while (pos < response.headers.size()) {
+    size_t end = response.headers.find("\r\n", pos);
+    size_t colon = response.headers.find(':', pos);
+    if (end == std::string::npos || colon > end) {
+      break;
+    }
+    size_t valueStart = std::min(colon + 2, end);
+    _headers->set(response.headers.substr(pos, colon - pos), response.headers.substr(valueStart, end - valueStart));
+    pos = end + 2;
+  }
+  if (getHeader("Connection").empty()) {
+    setHeader("Connection", _con->isKeepAlive() ? "keep-alive" : "close");
+  }
+  setHeader("Content-Length", intToString(response.body.size()));
+
+  printHeader();
+
+  // The response is complete, so finalize() has nothing left to send
+  _staging = true;
+  _fixedLength = true;
+  _remainingLength = 0;
+  _responseCachePointer = 0;
+
+  // The head is sent along with the body
+  ConnectionBufferSegment body = {(const byte*)response.body.data(), response.body.size()};
+  writeSegments(&body, 1);
+}
+
 } /* namespace httpsserver */
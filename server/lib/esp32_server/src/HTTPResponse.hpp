@@ -16,6 +16,7 @@
 #include "ConnectionContext.hpp"
 #include "HTTPHeaders.hpp"
 #include "HTTPHeader.hpp"
+#include "HTTPHandlerCache.hpp"
 
 namespace httpsserver {
 
@@ -25,6 +26,7 @@ namespace httpsserver {
 class HTTPResponse : public Print {
 public:
   HTTPResponse(ConnectionContext * con);
+  HTTPResponse(ConnectionContext * con, HTTPHeaders * headers, HTTPHeaders * defaultHeaders = NULL);
   virtual ~HTTPResponse();
 
   void setStatusCode(uint16_t statusCode);
@@ -40,30 +42,76 @@ public:
   // From Print:
   size_t write(const uint8_t *buffer, size_t size);
   size_t write(uint8_t);
+  void flush();
 
   void error();
 
   bool isResponseBuffered();
+  bool isChunked();
+  bool isBodyComplete();
+  bool isBodyOmitted();
+  void beginStream();
+  void beginStream(size_t contentLength);
   void finalize();
 
   ConnectionContext * _con;
   
 private:
+  friend class HTTPConnection;
+
+  void init();
+  void omitBody();
   void printHeader();
-  void printInternal(const std::string &str, bool skipBuffer = false);
-  size_t writeBytesInternal(const void * data, int length, bool skipBuffer = false);
-  void drainBuffer(bool onOverflow = false);
+  void serializeHead(std::string &buffer);
+  size_t writeBytesInternal(const void * data, int length);
+  void beginChunked();
+  void beginStaging();
+  bool growCache(size_t size);
+  void releaseCache();
+  void writeChunk(const byte * data, size_t length, bool last = false);
+  bool writeSegments(const ConnectionBufferSegment * segments, size_t count);
+
+  // Used by the connection for nodes with handler cache
+  void startRecording(HTTPHandlerCache::Response * recording, size_t limit);
+  bool finishRecording();
+  void replay(const HTTPHandlerCache::Response &response);
 
   uint16_t _statusCode;
   std::string _statusText;
-  HTTPHeaders _headers;
+  // Header storage, which is either owned by the response or reused from the connection
+  HTTPHeaders * _headers;
+  bool _ownsHeaders;
+  // Headers that are sent unless _headers contains the same name, may be NULL
+  HTTPHeaders * _defaultHeaders;
+  // The status line and the headers are final and stored in _head
   bool _headerWritten;
+  // _head has not been sent yet. It is sent with the next write to the connection
+  bool _headPending;
+  std::string _head;
   bool _isError;
+  // Body is sent with Transfer-Encoding: chunked, the response cache is used to collect the chunks
+  bool _chunked;
+  // The length of the response is not determined by the cache. It only collects writes, which are
+  // sent when it is full
+  bool _staging;
+  // The body has a Content-Length that has been sent before the body was complete. Only
+  // _remainingLength more bytes are accepted
+  bool _fixedLength;
+  size_t _remainingLength;
+  // Only the headers are sent, for a HEAD request. The body is only counted for the Content-Length
+  bool _omitBody;
 
   // Response cache
   byte * _responseCache;
   size_t _responseCacheSize;
   size_t _responseCachePointer;
+
+  // Receives a copy of the body for the handler cache, NULL if the response is not recorded or
+  // if the body has become larger than _recordingLimit
+  HTTPHandlerCache::Response * _recording;
+  size_t _recordingLimit;
+  // The headers that have been set before the handler was called, like "\r\nName: value\r\n..."
+  std::string _recordingBaseHeaders;
 };
 
 } /* namespace httpsserver */
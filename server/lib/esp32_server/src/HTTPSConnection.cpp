@@ -5,14 +5,32 @@ void handleHandshake(int status, const char* msg);
 namespace httpsserver {
 
 
-HTTPSConnection::HTTPSConnection(ResourceResolver * resResolver):
-  HTTPConnection(resResolver) {
+HTTPSConnection::HTTPSConnection(ResourceResolver * resResolver, size_t receiveBufferSize):
+  HTTPConnection(resResolver, receiveBufferSize) {
   _ssl = NULL;
+  _sslActive = false;
+  _handshakeWantsWrite = false;
+  _writeBuffer = NULL;
+  _writeBufferSize = 0;
 }
 
 HTTPSConnection::~HTTPSConnection() {
   // Close the socket
   closeConnection();
+
+  if (_ssl != NULL) {
+    SSL_free(_ssl);
+    _ssl = NULL;
+  }
+  delete[] _writeBuffer;
+}
+
+/**
+ * Resets the connection so that it can be reused. The SSL object is kept.
+ */
+void HTTPSConnection::reset() {
+  HTTPConnection::reset();
+  _handshakeWantsWrite = false;
 }
 
 bool HTTPSConnection::isSecure() {
@@ -23,6 +41,9 @@ bool HTTPSConnection::isSecure() {
  * Initializes the connection from a server socket.
  *
  * The call WILL BLOCK if accept(serverSocketID) blocks. So use select() to check for that in advance.
+ *
+ * The TLS handshake is not performed here. The connection enters STATE_HANDSHAKE and the handshake
+ * is continued from loop() whenever the client sends data, so a slow client does not block the server.
  */
 int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeaders *defaultHeaders) {
   if (_connectionState == STATE_UNDEFINED) {
@@ -32,21 +53,26 @@ int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeader
     // Build up SSL Connection context if the socket has been created successfully
     if (resSocket >= 0) {
 
-      _ssl = SSL_new(sslCtx);
+      // Reuse the SSL object of a previous connection if possible
+      if (_ssl == NULL) {
+        _ssl = SSL_new(sslCtx);
+        _allocationCount++;
+      }
 
       if (_ssl) {
+        _sslActive = true;
         // Bind SSL to the socket
         int success = SSL_set_fd(_ssl, resSocket);
         if (success) {
-          // Perform the handshake
-          success = SSL_accept(_ssl);
-          if (success) {
-            HTTPSConnection::handleRequest(true, "Successful SSL Handshake. Connection established.");
-            return resSocket;
-          } else {
-            HTTPS_LOGE("SSL_accept failed. Aborting handshake. FID=%d", resSocket);
-            HTTPSConnection::handleRequest(false, "Aborting handshake, SSL_accept failed.");
-          }
+          // The handshake is done on a non-blocking socket, so that SSL_accept() returns
+          // instead of waiting for the client
+          setSocketBlocking(false);
+          _connectionState = STATE_HANDSHAKE;
+          _handshakeTS = millis();
+
+          // Try to make progress right away, the ClientHello might already be there
+          continueHandshake();
+          return isClosed() ? -1 : resSocket;
         } else {
           HTTPS_LOGE("SSL_set_fd failed. Aborting handshake. FID=%d", resSocket);
           HTTPSConnection::handleRequest(false, "Aborting handshake, SSL_accept failed.");
@@ -72,6 +98,58 @@ int HTTPSConnection::initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeader
   return -1;
 }
 
+/**
+ * Performs the next step of the TLS handshake, as far as it is possible without blocking.
+ *
+ * Returns true once the handshake is complete and the connection is in STATE_INITIAL. If the
+ * handshake fails, the connection is closed.
+ */
+bool HTTPSConnection::continueHandshake() {
+  if (_connectionState != STATE_HANDSHAKE) {
+    return !isClosed();
+  }
+
+  int res = SSL_accept(_ssl);
+  if (res == 1) {
+    // From now on, the connection uses blocking I/O like the plain HTTPConnection
+    setSocketBlocking(true);
+    _handshakeWantsWrite = false;
+    _connectionState = STATE_INITIAL;
+    refreshTimeout();
+    HTTPS_LOGD("Handshake done. FID=%d", getSocket());
+    HTTPSConnection::handleRequest(true, "Successful SSL Handshake. Connection established.");
+    return true;
+  }
+
+  int err = SSL_get_error(_ssl, res);
+  if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+    // Not enough data yet, continue in the next loop pass
+    _handshakeWantsWrite = (err == SSL_ERROR_WANT_WRITE);
+    return false;
+  }
+
+  HTTPS_LOGE("SSL_accept failed. Aborting handshake. FID=%d", getSocket());
+  HTTPSConnection::handleRequest(false, "Aborting handshake, SSL_accept failed.");
+  _connectionState = STATE_ERROR;
+  _clientState = CSTATE_ACTIVE;
+  closeConnection();
+  return false;
+}
+
+/**
+ * Returns true if the handshake waits for the socket to become writable
+ */
+bool HTTPSConnection::isWaitingForWrite() {
+  return _connectionState == STATE_HANDSHAKE && _handshakeWantsWrite;
+}
+
+void HTTPSConnection::setSocketBlocking(bool blocking) {
+  int flags = fcntl(getSocket(), F_GETFL, 0);
+  if (flags >= 0) {
+    fcntl(getSocket(), F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+  }
+}
+
 /**
  * Handle the HTTPS request with a status code and a messasge string.
  */
@@ -81,6 +159,11 @@ void HTTPSConnection::handleRequest(int status, const char* msg) {
 
 void HTTPSConnection::closeConnection() {
 
+  // A connection that did not finish the handshake cannot be shut down gracefully
+  if (_connectionState == STATE_HANDSHAKE) {
+    _connectionState = STATE_ERROR;
+  }
+
   // FIXME: Copy from HTTPConnection, could be done better probably
   if (_connectionState != STATE_ERROR && _connectionState != STATE_CLOSED) {
 
@@ -95,29 +178,120 @@ void HTTPSConnection::closeConnection() {
   }
 
   // Try to tear down SSL while we are in the _shutdownTS timeout period or if an error occurred
-  if (_ssl) {
-    if(_connectionState == STATE_ERROR || SSL_shutdown(_ssl) == 0) {
-      // SSL_shutdown will return 1 as soon as the client answered with close notify
-      // This means we are safe to close the socket
-      SSL_free(_ssl);
-      _ssl = NULL;
+  if (_sslActive) {
+    if(_connectionState == STATE_ERROR || isShutdownDone(SSL_shutdown(_ssl))) {
+      // Our close notify has been sent (SSL_shutdown returns 0), or the client has sent its own
+      // already (1). This means we are safe to close the socket
+      releaseSSL();
     } else if (_shutdownTS + HTTPS_SHUTDOWN_TIMEOUT < millis()) {
-      // The timeout has been hit, we force SSL shutdown now by freeing the context
-      SSL_free(_ssl);
-      _ssl = NULL;
+      // The timeout has been hit, we force SSL shutdown now
       HTTPS_LOGW("SSL_shutdown did not receive close notification from the client");
       _connectionState = STATE_ERROR;
+      releaseSSL();
     }
   }
 
   // If SSL has been brought down, close the socket
-  if (!_ssl) {
+  if (!_sslActive) {
     HTTPConnection::closeConnection();
   }
 }
 
+/**
+ * Evaluates the result of SSL_shutdown(). Only if the socket was not ready, shutting down is
+ * retried by the next call to closeConnection(). Other errors, e.g. if the client has closed the
+ * socket already, end the shutdown.
+ */
+bool HTTPSConnection::isShutdownDone(int result) {
+  if (result >= 0) {
+    return true;
+  }
+  int error = SSL_get_error(_ssl, result);
+  return error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE;
+}
+
+/**
+ * Detaches the SSL object from the socket. If the connection ended regularly, the object is cleared
+ * and kept for the next connection. After an error, it is freed.
+ */
+void HTTPSConnection::releaseSSL() {
+  if (_ssl != NULL) {
+    if (_connectionState == STATE_ERROR || SSL_clear(_ssl) != 1) {
+      SSL_free(_ssl);
+      _ssl = NULL;
+    }
+  }
+  _sslActive = false;
+}
+
 size_t HTTPSConnection::writeBuffer(byte* buffer, size_t length) {
-  return SSL_write(_ssl, buffer, length);
+  return writeSSL(buffer, length);
+}
+
+/**
+ * Writes the blocks with as few calls to SSL_write() as possible. Each call creates at least one
+ * TLS record, which has its own header and MAC, so small blocks are combined in _writeBuffer.
+ *
+ * The buffer grows up to the size of a full response cache plus its chunk framing, so that each
+ * chunk of a response is sent as a single record.
+ */
+size_t HTTPSConnection::writeBuffers(const ConnectionBufferSegment * segments, size_t count) {
+  size_t total = 0;
+  for(size_t i = 0; i < count; i++) {
+    total += segments[i].length;
+  }
+  size_t maxSize = getMaxCacheSize() + HTTPS_TLS_WRITE_BUFFER_RESERVE;
+  if (maxSize < HTTPS_TLS_WRITE_BUFFER_SIZE) {
+    maxSize = HTTPS_TLS_WRITE_BUFFER_SIZE;
+  }
+  if (_writeBuffer == NULL || (total > _writeBufferSize && _writeBufferSize < maxSize)) {
+    delete[] _writeBuffer;
+    _writeBufferSize = total < HTTPS_TLS_WRITE_BUFFER_SIZE ? HTTPS_TLS_WRITE_BUFFER_SIZE : (total < maxSize ? total : maxSize);
+    _writeBuffer = new byte[_writeBufferSize];
+    _allocationCount++;
+  }
+  size_t written = 0;
+  size_t fill = 0;
+  for(size_t i = 0; i < count; i++) {
+    const ConnectionBufferSegment &segment = segments[i];
+    if (fill + segment.length <= _writeBufferSize) {
+      memcpy(_writeBuffer + fill, segment.data, segment.length);
+      fill += segment.length;
+      continue;
+    }
+    // The block does not fit anymore. Send what has been collected so far, and then either
+    // collect the block or send it directly if it is too large for the buffer
+    if (fill > 0) {
+      if (writeSSL(_writeBuffer, fill) != fill) {
+        return written;
+      }
+      written += fill;
+      fill = 0;
+    }
+    if (segment.length <= _writeBufferSize) {
+      memcpy(_writeBuffer, segment.data, segment.length);
+      fill = segment.length;
+    } else {
+      if (writeSSL(segment.data, segment.length) != segment.length) {
+        return written;
+      }
+      written += segment.length;
+    }
+  }
+  if (fill > 0 && writeSSL(_writeBuffer, fill) == fill) {
+    written += fill;
+  }
+  return written;
+}
+
+/**
+ * Calls SSL_write() and updates the write and record counters
+ */
+size_t HTTPSConnection::writeSSL(const byte * data, size_t length) {
+  _writeCount++;
+  // OpenSSL splits the data into records of up to 16 kB
+  _recordCount += (length + 16383) / 16384;
+  return SSL_write(_ssl, data, length);
 }
 
 size_t HTTPSConnection::readBytesToBuffer(byte* buffer, size_t length) {
@@ -125,11 +299,11 @@ size_t HTTPSConnection::readBytesToBuffer(byte* buffer, size_t length) {
 }
 
 size_t HTTPSConnection::pendingByteCount() {
-  return SSL_pending(_ssl);
+  return _sslActive ? SSL_pending(_ssl) : 0;
 }
 
 bool HTTPSConnection::canReadData() {
-  return HTTPConnection::canReadData() || (SSL_pending(_ssl) > 0);
+  return HTTPConnection::canReadData() || (pendingByteCount() > 0);
 }
 
 } /* namespace httpsserver */
@@ -31,13 +31,15 @@ namespace httpsserver {
  */
 class HTTPSConnection : public HTTPConnection {
 public:
-  HTTPSConnection(ResourceResolver * resResolver);
+  HTTPSConnection(ResourceResolver * resResolver, size_t receiveBufferSize = HTTPS_CONNECTION_DATA_CHUNK_SIZE);
   virtual ~HTTPSConnection();
 
   virtual int initialize(int serverSocketID, SSL_CTX * sslCtx, HTTPHeaders *defaultHeaders);
   virtual void handleRequest(int status, const char* msg);
   virtual void closeConnection();
   virtual bool isSecure();
+  virtual bool isWaitingForWrite();
+  virtual void reset();
 
 protected:
   friend class HTTPRequest;
@@ -47,10 +49,27 @@ protected:
   virtual size_t pendingByteCount();
   virtual bool canReadData();
   virtual size_t writeBuffer(byte* buffer, size_t length);
+  virtual size_t writeBuffers(const ConnectionBufferSegment * segments, size_t count);
+  virtual bool continueHandshake();
 
 private:
-  // SSL context for this connection
+  void setSocketBlocking(bool blocking);
+  void releaseSSL();
+  size_t writeSSL(const byte * data, size_t length);
+  bool isShutdownDone(int result);
+
+  // SSL context for this connection. It is kept for reuse after the connection has been closed
   SSL * _ssl;
+  // True while _ssl is bound to the current socket
+  bool _sslActive;
+
+  // True if the last step of the handshake has to wait for the socket to become writable
+  bool _handshakeWantsWrite;
+
+  // Buffer to combine the blocks passed to writeBuffers() into a single record. It is allocated
+  // on first use and kept for reuse, like _ssl
+  byte * _writeBuffer;
+  size_t _writeBufferSize;
 
 };
 
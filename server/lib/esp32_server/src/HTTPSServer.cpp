@@ -54,10 +54,12 @@ void HTTPSServer::teardownSocket() {
   _sslctx = NULL;
 }
 
-int HTTPSServer::createConnection(int idx) {
-  HTTPSConnection * newConnection = new HTTPSConnection(this);
-  _connections[idx] = newConnection;
-  return newConnection->initialize(_socket, _sslctx, &_defaultHeaders);
+HTTPConnection * HTTPSServer::createConnection() {
+  return new HTTPSConnection(this, _receiveBufferSize);
+}
+
+int HTTPSServer::initializeConnection(HTTPConnection * connection) {
+  return ((HTTPSConnection *)connection)->initialize(_socket, _sslctx, &_defaultHeaders);
 }
 
 /**
@@ -48,7 +48,8 @@ private:
   uint8_t setupCert();
 
   // Helper functions
-  virtual int createConnection(int idx);
+  virtual HTTPConnection * createConnection();
+  virtual int initializeConnection(HTTPConnection * connection);
 };
 
 } /* namespace httpsserver */
@@ -59,28 +59,110 @@
 #define HTTPS_REQUEST_MAX_HEADER_LENGTH        384
 #endif
 
-// Chunk size used for reading data from the ssl-enabled socket
+// Maximum size of a request body that is sent with Transfer-Encoding: chunked (after decoding)
+#ifndef HTTPS_REQUEST_MAX_CHUNKED_BODY_SIZE
+#define HTTPS_REQUEST_MAX_CHUNKED_BODY_SIZE  65536
+#endif
+
+// Default size of the receive buffer of each connection (see HTTPServer::setReceiveBufferSize())
 #ifndef HTTPS_CONNECTION_DATA_CHUNK_SIZE
 #define HTTPS_CONNECTION_DATA_CHUNK_SIZE       512
 #endif
 
+// Minimum size of the receive buffer of a connection
+#ifndef HTTPS_CONNECTION_MIN_BUFFER_SIZE
+#define HTTPS_CONNECTION_MIN_BUFFER_SIZE       64
+#endif
+
+// Maximum number of pipelined requests that a connection processes in a single call to its loop()
+// function if they have already been received. Further requests are handled in the next pass, so
+// that a single client cannot stall the other connections.
+#ifndef HTTPS_PIPELINE_MAX_DEPTH
+#define HTTPS_PIPELINE_MAX_DEPTH               4
+#endif
+
 // Size (in bytes) of the Connection:keep-alive Cache (we need to be able to
 // store-and-forward the response to calculate the content-size)
+// The cache starts with this size and grows up to HTTPS_KEEPALIVE_CACHE_MAXSIZE
+// (see HTTPServer::setMaxResponseCacheSize()) before the response is sent in chunks.
 #ifndef HTTPS_KEEPALIVE_CACHESIZE
 #define HTTPS_KEEPALIVE_CACHESIZE              1400
 #endif
 
+// Default for the maximum size (in bytes) of the Connection:keep-alive Cache
+#ifndef HTTPS_KEEPALIVE_CACHE_MAXSIZE
+#define HTTPS_KEEPALIVE_CACHE_MAXSIZE          5600
+#endif
+
+// Default size (in bytes) of the cache for the responses of nodes that enable it, see
+// ResourceNode::setHandlerCacheTTL() and HTTPServer::setHandlerCacheCapacity()
+#ifndef HTTPS_HANDLER_CACHE_SIZE
+#define HTTPS_HANDLER_CACHE_SIZE               16384
+#endif
+
+// Number of response buffers of each size that a worker keeps for reuse
+#ifndef HTTPS_BUFFER_POOL_DEPTH
+#define HTTPS_BUFFER_POOL_DEPTH                1
+#endif
+
+// Size (in bytes) of the buffer that collects the writes of a response that is not cached, e.g.
+// if the connection is closed afterwards. The status line and the headers are sent along with it.
+#ifndef HTTPS_RESPONSE_STAGING_SIZE
+#define HTTPS_RESPONSE_STAGING_SIZE            1400
+#endif
+
+// Size (in bytes) of the buffer in which an HTTPSConnection combines several blocks of data, so
+// that they are sent as a single TLS record. Larger blocks are written separately.
+#ifndef HTTPS_TLS_WRITE_BUFFER_SIZE
+#define HTTPS_TLS_WRITE_BUFFER_SIZE            2048
+#endif
+
+// Space (in bytes) for the status line, headers and chunk framing that the TLS write buffer may
+// grow by beyond the maximum response cache size
+#ifndef HTTPS_TLS_WRITE_BUFFER_RESERVE
+#define HTTPS_TLS_WRITE_BUFFER_RESERVE         512
+#endif
+
+// Size (in bytes) of the blocks in which StaticFileNode reads a file. The buffer is located on
+// the stack of the thread that processes the connection
+#ifndef HTTPS_STATIC_FILE_CHUNK_SIZE
+#define HTTPS_STATIC_FILE_CHUNK_SIZE           1024
+#endif
+
 // Timeout for an HTTPS connection without any transmission
 #ifndef HTTPS_CONNECTION_TIMEOUT
 #define HTTPS_CONNECTION_TIMEOUT               20000
 #endif
 
+// Timeout for the TLS handshake of a new HTTPS connection (ms)
+// Connections that do not complete the handshake within this time are dropped
+#ifndef HTTPS_HANDSHAKE_TIMEOUT
+#define HTTPS_HANDSHAKE_TIMEOUT                3000
+#endif
+
 // Timeout used to wait for shutdown of SSL connection (ms)
 // (time for the client to return notify close flag) - without it, truncation attacks might be possible
 #ifndef HTTPS_SHUTDOWN_TIMEOUT
 #define HTTPS_SHUTDOWN_TIMEOUT                 5000
 #endif
 
+// Stack size (in bytes) of the threads used in worker mode (see HTTPServer::setWorkerCount())
+// The handshake of a TLS connection needs a lot of stack, so don't go below 6kB for HTTPS
+#ifndef HTTPS_WORKER_STACK_SIZE
+#define HTTPS_WORKER_STACK_SIZE                8192
+#endif
+
+// Maximum time (ms) a worker waits for socket activity before it checks its connections for timeouts.
+// New connections wake the worker up immediately
+#ifndef HTTPS_WORKER_POLL_TIMEOUT
+#define HTTPS_WORKER_POLL_TIMEOUT              10
+#endif
+
+// Number of accepted sockets that can wait for being taken over by a worker
+#ifndef HTTPS_WORKER_QUEUE_SIZE
+#define HTTPS_WORKER_QUEUE_SIZE                8
+#endif
+
 // Length of a SHA1 hash
 #ifndef HTTPS_SHA1_LENGTH
 #define HTTPS_SHA1_LENGTH                      20
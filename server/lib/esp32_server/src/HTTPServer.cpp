@@ -8,13 +8,21 @@ HTTPServer::HTTPServer(const uint16_t port, const uint8_t maxConnections, const
   _maxConnections(maxConnections),
   _bindAddress(bindAddress) {
 
-  // Create space for the connections
-  _connections = new HTTPConnection*[maxConnections];
-  for(uint8_t i = 0; i < maxConnections; i++) _connections[i] = NULL;
+  _receiveBufferSize = HTTPS_CONNECTION_DATA_CHUNK_SIZE;
+  _pipelineDepth = HTTPS_PIPELINE_MAX_DEPTH;
+  _maxResponseCacheSize = HTTPS_KEEPALIVE_CACHE_MAXSIZE;
+
+  // Workers are created in start()
+  _workerCount = 0;
+  _workers = NULL;
+  _workersCreated = 0;
 
   // Configure runtime data
   _socket = -1;
   _running = false;
+
+  // The default headers are written with every response, so they are kept serialized
+  _defaultHeaders.keepSerialized();
 }
 
 HTTPServer::~HTTPServer() {
@@ -24,9 +32,6 @@ HTTPServer::~HTTPServer() {
   if(_running) {
     stop();
   }
-
-  // Delete connection pointers
-  delete[] _connections;
 }
 
 /**
@@ -35,6 +40,7 @@ HTTPServer::~HTTPServer() {
 uint8_t HTTPServer::start() {
   if (!_running) {
     if (setupSocket()) {
+      setupWorkers();
       _running = true;
       return 1;
     }
@@ -58,110 +64,267 @@ void HTTPServer::stop() {
     _running = false;
 
     // Clean up the connections
-    bool hasOpenConnections = true;
-    while(hasOpenConnections) {
-      hasOpenConnections = false;
-      for(int i = 0; i < _maxConnections; i++) {
-        if (_connections[i] != NULL) {
-          _connections[i]->closeConnection();
-
-          // Check if closing succeeded. If not, we need to call the close function multiple times
-          // and wait for the client
-          if (_connections[i]->isClosed()) {
-            delete _connections[i];
-            _connections[i] = NULL;
-          } else {
-            hasOpenConnections = true;
-          }
-        }
-      }
-      delay(1);
-    }
+    teardownWorkers();
 
     teardownSocket();
 
   }
 }
 
+/**
+ * Sets the size of the receive buffer that each connection uses (HTTPS_CONNECTION_DATA_CHUNK_SIZE by
+ * default). Larger buffers allow to receive request bodies and websocket data with less calls to the
+ * socket, at the cost of memory for each connection slot.
+ *
+ * Must be called before start(). Values below HTTPS_CONNECTION_MIN_BUFFER_SIZE are raised to that size.
+ */
+void HTTPServer::setReceiveBufferSize(size_t receiveBufferSize) {
+  if (!_running) {
+    _receiveBufferSize = std::max(receiveBufferSize, (size_t)HTTPS_CONNECTION_MIN_BUFFER_SIZE);
+  }
+}
+
+/**
+ * Sets the maximum number of pipelined requests that a connection processes in one pass if the
+ * client has sent them at once. Responses are always sent in the order of the requests.
+ *
+ * Takes effect for connections that are accepted afterwards. Values below 1 are raised to 1.
+ */
+void HTTPServer::setPipelineDepth(uint8_t pipelineDepth) {
+  _pipelineDepth = std::max(pipelineDepth, (uint8_t)1);
+}
+
+/**
+ * Sets the size (in bytes) up to which the cache of a keep-alive response grows. Responses up to
+ * this size are sent with a Content-Length, larger ones are sent in chunks
+ * (HTTPS_KEEPALIVE_CACHE_MAXSIZE by default).
+ *
+ * The buffers are kept by each worker for reuse, so a worker holds up to about twice this size
+ * after a large response. Must be called before start(). Values below HTTPS_KEEPALIVE_CACHESIZE are
+ * raised to that size.
+ */
+void HTTPServer::setMaxResponseCacheSize(size_t maxResponseCacheSize) {
+  if (!_running) {
+    _maxResponseCacheSize = std::max(maxResponseCacheSize, (size_t)HTTPS_KEEPALIVE_CACHESIZE);
+  }
+}
+
+/**
+ * Enables worker mode: The connections will be processed by workerCount threads, each owning an
+ * equal share of the maxConnections connection slots.
+ *
+ * Must be called before start(). 0 (the default) disables worker mode. The count is limited to
+ * maxConnections.
+ *
+ * See the class description for the thread-safety requirements of handler functions.
+ */
+void HTTPServer::setWorkerCount(uint8_t workerCount) {
+  if (!_running) {
+    _workerCount = std::min(workerCount, _maxConnections);
+  }
+}
+
+/**
+ * Returns the number of threaded workers (0 if worker mode is disabled)
+ */
+uint8_t HTTPServer::getWorkerCount() {
+  return _workerCount;
+}
+
+/**
+ * Returns statistics of a single worker. Without worker mode, index 0 returns the statistics of
+ * the connections processed in loop().
+ */
+HTTPWorkerStats HTTPServer::getWorkerStats(uint8_t workerIdx) {
+  if (workerIdx < _workersCreated) {
+    return _workers[workerIdx]->getStats();
+  }
+  HTTPWorkerStats stats = {};
+  return stats;
+}
+
+/**
+ * Creates the workers and distributes the connection slots over them
+ */
+void HTTPServer::setupWorkers() {
+  if (_workerCount == 0) {
+    // A single worker that accepts the connections itself and that is run by loop()
+    _workersCreated = 1;
+    _workers = new HTTPWorker*[1];
+    _workers[0] = new HTTPWorker(this, 0, _maxConnections, _socket);
+  } else {
+    _workersCreated = _workerCount;
+    _workers = new HTTPWorker*[_workerCount];
+    for(uint8_t i = 0; i < _workerCount; i++) {
+      uint8_t slots = _maxConnections / _workerCount + (i < _maxConnections % _workerCount ? 1 : 0);
+      _workers[i] = new HTTPWorker(this, i, slots);
+      _workers[i]->startThread();
+    }
+  }
+}
+
+/**
+ * Stops the workers and closes all connections
+ */
+void HTTPServer::teardownWorkers() {
+  for(uint8_t i = 0; i < _workersCreated; i++) {
+    // Deleting a worker stops its thread and closes its connections
+    delete _workers[i];
+  }
+  delete[] _workers;
+  _workers = NULL;
+  _workersCreated = 0;
+}
+
 /**
  * Adds a default header that is included in every response.
  *
- * This could be used for example to add a Server: header or for CORS options
+ * This could be used for example to add a Server: header or for CORS options. A response
+ * overrides a default header by setting a header of the same name.
+ *
+ * The headers are written as a block that is serialized here, so they should not be changed while
+ * the server processes requests.
  */
 void HTTPServer::setDefaultHeader(std::string name, std::string value) {
-  _defaultHeaders.set(new HTTPHeader(name, value));
+  _defaultHeaders.set(name, value);
+}
+
+/**
+ * Sets the body of an error response that the server sends without calling a handler: 400 and
+ * 431 for malformed requests, and 404 if no node matches and no default node is set.
+ *
+ * The response is serialized here and sent with a single write, like the built-in one. Like the
+ * default headers, it should not be changed while the server processes requests.
+ */
+void HTTPServer::setErrorBody(uint16_t statusCode, std::string const &body, std::string const &contentType) {
+  _errorResponses.setBody(statusCode, body, contentType);
+}
+
+/**
+ * Sets the maximum number of bytes (keys, headers and bodies) that the handler cache holds
+ * (HTTPS_HANDLER_CACHE_SIZE by default). A single response may use up to a quarter of it.
+ *
+ * The cache only stores responses of nodes that enable it with ResourceNode::setHandlerCacheTTL().
+ */
+void HTTPServer::setHandlerCacheCapacity(size_t capacity) {
+  _handlerCache.setCapacity(capacity);
+}
+
+/**
+ * Removes all responses from the handler cache, for example after data that the cached handlers
+ * return has changed. May be called while the server is running.
+ */
+void HTTPServer::clearHandlerCache() {
+  _handlerCache.clear();
+}
+
+/**
+ * Returns hits, misses, evictions and the memory usage of the handler cache. May be called from
+ * other threads while the server is running.
+ */
+HTTPHandlerCacheStats HTTPServer::getHandlerCacheStats() {
+  return _handlerCache.getStats();
 }
 
 /**
  * The loop method can either be called by periodical interrupt or in the main loop and handles processing
  * of data
+ *
+ * The readiness of the server socket and of all open connections is determined by a single call to
+ * select(). Only connections that are readable, have buffered data or need to progress in their state
+ * machine (timeout, closing, ...) are processed.
+ *
+ * Returns the number of connections that have been processed during this pass.
+ *
+ * In worker mode, the connections are processed by the workers. loop() then only accepts new
+ * connections and returns the number of connections that have been handed over to a worker.
  */
-void HTTPServer::loop() {
+uint8_t HTTPServer::loop() {
 
   // Only handle requests if the server is still running
-  if(!_running) return;
+  if(!_running) return 0;
 
-  // Step 1: Process existing connections
-  // Process open connections and store the index of a free connection
-  // (we might use that later on)
-  int freeConnectionIdx = -1;
-  for (int i = 0; i < _maxConnections; i++) {
-    // Fetch a free index in the pointer array
-    if (_connections[i] == NULL) {
-      freeConnectionIdx = i;
+  if (_workerCount == 0) {
+    return _workers[0]->loop();
+  }
 
-    } else {
-      // if there is a connection (_connections[i]!=NULL), check if its open or closed:
-      if (_connections[i]->isClosed()) {
-        // if it's closed, clean up:
-        delete _connections[i];
-        _connections[i] = NULL;
-        freeConnectionIdx = i;
-      } else {
-        // if not, process it:
-        _connections[i]->loop();
-      }
-    }
+  uint8_t dispatchedConnections = 0;
+  while(dispatchConnection()) {
+    dispatchedConnections++;
   }
- 
-  // Step 2: Check for new connections
-  // This makes only sense if there is space to store the connection
-  if (freeConnectionIdx > -1) {
-
-    // We create a file descriptor set to be able to use the select function
-    fd_set sockfds;
-    // Out socket is the only socket in this set
-    FD_ZERO(&sockfds);
-    FD_SET(_socket, &sockfds);
-
-    // We define a "immediate" timeout
-    timeval timeout;
-    timeout.tv_sec  = 0;
-    timeout.tv_usec = 0; // Return immediately, if possible
-
-    // Wait for input
-    // As by 2017-12-14, it seems that FD_SETSIZE is defined as 0x40, but socket IDs now
-    // start at 0x1000, so we need to use _socket+1 here
-    select(_socket + 1, &sockfds, NULL, NULL, &timeout);
-
-    // There is input
-    if (FD_ISSET(_socket, &sockfds)) {
-      int socketIdentifier = createConnection(freeConnectionIdx);
-
-      // If initializing did not work, discard the new socket immediately
-      if (socketIdentifier < 0) {
-        delete _connections[freeConnectionIdx];
-        _connections[freeConnectionIdx] = NULL;
-      }
+  return dispatchedConnections;
+}
+
+/**
+ * Accepts a pending connection and passes it to the worker with the lowest load.
+ *
+ * Returns true if a connection has been dispatched.
+ */
+bool HTTPServer::dispatchConnection() {
+  // Find the worker with the lowest load. If all workers are busy, the connection stays in the backlog.
+  HTTPWorker * worker = NULL;
+  uint8_t workerFree = 0;
+  for(uint8_t i = 0; i < _workersCreated; i++) {
+    uint8_t load = _workers[i]->getLoad();
+    uint8_t maxConnections = _workers[i]->getMaxConnections();
+    if (load < maxConnections && maxConnections - load > workerFree) {
+      worker = _workers[i];
+      workerFree = maxConnections - load;
     }
+  }
+  if (worker == NULL) {
+    return false;
+  }
+
+  // We create a file descriptor set to be able to use the select function
+  fd_set sockfds;
+  // Out socket is the only socket in this set
+  FD_ZERO(&sockfds);
+  FD_SET(_socket, &sockfds);
+
+  // We define a "immediate" timeout
+  timeval timeout;
+  timeout.tv_sec  = 0;
+  timeout.tv_usec = 0; // Return immediately, if possible
+
+  // As by 2017-12-14, it seems that FD_SETSIZE is defined as 0x40, but socket IDs now
+  // start at 0x1000, so we need to use _socket+1 here
+  select(_socket + 1, &sockfds, NULL, NULL, &timeout);
+  if (!FD_ISSET(_socket, &sockfds)) {
+    return false;
+  }
+
+  sockaddr addr;
+  socklen_t addrLen = sizeof(addr);
+  int socket = accept(_socket, &addr, &addrLen);
+  if (socket < 0) {
+    HTTPS_LOGE("Could not accept() new connection");
+    return false;
+  }
 
+  if (!worker->enqueueSocket(socket, &addr, addrLen)) {
+    HTTPS_LOGW("Queue of worker %d is full, dropping connection. FID=%d", worker->getId(), socket);
+    close(socket);
+    return false;
   }
+  HTTPS_LOGD("Passed connection to worker %d. FID=%d", worker->getId(), socket);
+  return true;
 }
 
-int HTTPServer::createConnection(int idx) {
-  HTTPConnection * newConnection = new HTTPConnection(this);
-  _connections[idx] = newConnection;
-  return newConnection->initialize(_socket, &_defaultHeaders);
+/**
+ * Creates a new connection object. This is done once for every connection slot when the server is
+ * started, the object is then reused for every socket in that slot. The connection is set up by
+ * initializeConnection()
+ */
+HTTPConnection * HTTPServer::createConnection() {
+  return new HTTPConnection(this, _receiveBufferSize);
+}
+
+/**
+ * Initializes a connection that has been created by createConnection()
+ */
+int HTTPServer::initializeConnection(HTTPConnection * connection) {
+  return connection->initialize(_socket, &_defaultHeaders);
 }
 
 /**
@@ -17,15 +17,31 @@
 #include "HTTPSServerConstants.hpp"
 #include "HTTPHeaders.hpp"
 #include "HTTPHeader.hpp"
+#include "HTTPErrorResponses.hpp"
+#include "HTTPHandlerCache.hpp"
 #include "ResourceNode.hpp"
 #include "ResourceResolver.hpp"
 #include "ResolvedResource.hpp"
 #include "HTTPConnection.hpp"
+#include "HTTPWorker.hpp"
 
 namespace httpsserver {
 
 /**
  * \brief Main implementation for the plain HTTP server. Use HTTPSServer for TLS support
+ *
+ * **Worker mode**
+ *
+ * By default, all connections are processed sequentially during the call to loop(). If
+ * setWorkerCount() is called before start(), the connection slots are distributed over
+ * several workers that run in their own threads. loop() then only accepts new connections
+ * and hands them over to the worker with the lowest load.
+ *
+ * In worker mode, handler and middleware functions are called concurrently from different
+ * threads. They must therefore be thread-safe, i.e. protect any state they share with other
+ * handlers (or with the rest of the sketch) by a mutex or similar. The request and response
+ * objects passed to a handler are only used by the calling thread. Nodes, middleware and
+ * default headers must not be changed while the server is running.
  */
 class HTTPServer : public ResourceResolver {
 public:
@@ -36,11 +52,26 @@ public:
   void stop();
   bool isRunning();
 
-  void loop();
+  uint8_t loop();
 
   void setDefaultHeader(std::string name, std::string value);
+  void setErrorBody(uint16_t statusCode, std::string const &body, std::string const &contentType = "text/html");
+
+  void setReceiveBufferSize(size_t receiveBufferSize);
+  void setPipelineDepth(uint8_t pipelineDepth);
+  void setMaxResponseCacheSize(size_t maxResponseCacheSize);
+
+  void setHandlerCacheCapacity(size_t capacity);
+  void clearHandlerCache();
+  HTTPHandlerCacheStats getHandlerCacheStats();
+
+  void setWorkerCount(uint8_t workerCount);
+  uint8_t getWorkerCount();
+  HTTPWorkerStats getWorkerStats(uint8_t workerIdx);
 
 protected:
+  friend class HTTPWorker;
+
   // Static configuration. Port, keys, etc. ====================
   // Certificate that should be used (includes private key)
   const uint16_t _port;
@@ -50,9 +81,23 @@ protected:
   // Address to bind to (0 = all interfaces)
   const in_addr_t _bindAddress;
 
+  // Number of threaded workers (0 = process connections in loop())
+  uint8_t _workerCount;
+
+  // Size of the receive buffer of each connection
+  size_t _receiveBufferSize;
+
+  // Maximum number of pipelined requests per connection and loop pass
+  uint8_t _pipelineDepth;
+
+  // Size up to which the cache of a keep-alive response grows before the response is streamed
+  size_t _maxResponseCacheSize;
+
   //// Runtime data ============================================
-  // The array of connections that are currently active
-  HTTPConnection ** _connections;
+  // The workers that own the connection slots. Without worker mode, there is a single worker
+  // that is run by loop()
+  HTTPWorker ** _workers;
+  uint8_t _workersCreated;
   // Status of the server: Are we running, or not?
   boolean _running;
   // The server socket
@@ -62,13 +107,23 @@ protected:
   sockaddr_in _sock_addr;
   // Headers that are included in every response
   HTTPHeaders _defaultHeaders;
+  // Responses for errors that are raised by the connection itself
+  HTTPErrorResponses _errorResponses;
+  // Responses of nodes with ResourceNode::setHandlerCacheTTL(), shared by all workers
+  HTTPHandlerCache _handlerCache;
 
   // Setup functions
   virtual uint8_t setupSocket();
   virtual void teardownSocket();
 
+  // Setup of the workers
+  void setupWorkers();
+  void teardownWorkers();
+  bool dispatchConnection();
+
   // Helper functions
-  virtual int createConnection(int idx);
+  virtual HTTPConnection * createConnection();
+  virtual int initializeConnection(HTTPConnection * connection);
 };
 
 }
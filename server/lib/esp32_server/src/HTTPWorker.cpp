@@ -0,0 +1,393 @@
+#include "HTTPWorker.hpp"
+#include "HTTPServer.hpp"
+
+namespace httpsserver {
+
+HTTPWorker::HTTPWorker(HTTPServer * server, uint8_t id, uint8_t maxConnections, int listenSocket):
+  _server(server),
+  _id(id),
+  _maxConnections(maxConnections),
+  _listenSocket(listenSocket),
+  _bufferPool(HTTPS_KEEPALIVE_CACHESIZE, server->_maxResponseCacheSize),
+  _queueHead(0),
+  _queueTail(0),
+  _wakeupSocket(-1),
+  _threadStarted(false),
+  _threadRunning(false),
+  _statAccepted(0),
+  _statDropped(0),
+  _statLoopPasses(0),
+  _statServiced(0),
+  _statOpen(0) {
+
+  // Create the connection objects once. They are reset and reused when a connection is closed,
+  // so there is no heap churn for every new socket
+  _connections = new HTTPConnection*[maxConnections];
+  _active = new bool[maxConnections];
+  for(uint8_t i = 0; i < maxConnections; i++) {
+    _connections[i] = _server->createConnection();
+    _active[i] = false;
+  }
+}
+
+HTTPWorker::~HTTPWorker() {
+  stopThread();
+  closeConnections();
+
+  // Delete the connection objects
+  for(uint8_t i = 0; i < _maxConnections; i++) {
+    delete _connections[i];
+  }
+  delete[] _connections;
+  delete[] _active;
+}
+
+/**
+ * Starts a thread that runs the loop of this worker until stopThread() is called
+ */
+bool HTTPWorker::startThread() {
+  if (_threadStarted) {
+    return true;
+  }
+
+  // Without the wakeup socket, new connections are only taken over after HTTPS_WORKER_POLL_TIMEOUT
+  if (!openWakeupSocket()) {
+    HTTPS_LOGW("Could not create wakeup socket for worker %d", _id);
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, HTTPS_WORKER_STACK_SIZE);
+
+  _threadRunning = true;
+  int res = pthread_create(&_thread, &attr, &HTTPWorker::threadEntry, this);
+  pthread_attr_destroy(&attr);
+
+  if (res != 0) {
+    HTTPS_LOGE("Could not create thread for worker %d", _id);
+    _threadRunning = false;
+    return false;
+  }
+  _threadStarted = true;
+  return true;
+}
+
+/**
+ * Stops the worker thread (if any). The thread closes all of its connections before it terminates.
+ */
+void HTTPWorker::stopThread() {
+  if (_threadStarted) {
+    _threadRunning = false;
+    wakeup();
+    pthread_join(_thread, NULL);
+    _threadStarted = false;
+  }
+  if (_wakeupSocket >= 0) {
+    close(_wakeupSocket);
+    _wakeupSocket = -1;
+  }
+}
+
+/**
+ * Creates a UDP socket on the loopback interface that is connected to itself. The worker adds it
+ * to its select(), so sending a datagram to it wakes the worker up. lwIP provides neither pipes
+ * nor socketpair(), so a UDP socket is used.
+ */
+bool HTTPWorker::openWakeupSocket() {
+  _wakeupSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (_wakeupSocket < 0) {
+    return false;
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrLen = sizeof(addr);
+  // Bind to a free port, then connect the socket to the address it got
+  if (bind(_wakeupSocket, (sockaddr *)&addr, addrLen) < 0 ||
+      getsockname(_wakeupSocket, (sockaddr *)&addr, &addrLen) < 0 ||
+      connect(_wakeupSocket, (sockaddr *)&addr, addrLen) < 0) {
+    close(_wakeupSocket);
+    _wakeupSocket = -1;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Ends the select() of the worker thread, if it is waiting. Can be called from any thread.
+ */
+void HTTPWorker::wakeup() {
+  if (_wakeupSocket >= 0) {
+    byte signal = 1;
+    // If the socket buffer is full, the worker has not woken up yet anyway
+    send(_wakeupSocket, &signal, 1, MSG_DONTWAIT);
+  }
+}
+
+bool HTTPWorker::isThreaded() {
+  return _threadStarted;
+}
+
+void * HTTPWorker::threadEntry(void * worker) {
+  HTTPWorker * self = (HTTPWorker *)worker;
+  HTTPS_LOGI("Worker %d started", self->_id);
+  while(self->_threadRunning) {
+    self->loop(HTTPS_WORKER_POLL_TIMEOUT);
+  }
+  self->closeConnections();
+  HTTPS_LOGI("Worker %d stopped", self->_id);
+  return NULL;
+}
+
+/**
+ * Runs one pass over the connections of this worker.
+ *
+ * The readiness of all sockets is determined by a single call to select(), which waits for up to timeoutMs
+ * milliseconds if none of the connections has work to do. Only connections that are readable, have buffered
+ * data or need to progress in their state machine (timeout, closing, ...) are processed.
+ *
+ * Returns the number of connections that have been processed during this pass.
+ */
+uint8_t HTTPWorker::loop(unsigned long timeoutMs) {
+  _statLoopPasses++;
+
+  // Step 1: Clean up closed connections and take over sockets from the queue
+  int freeConnectionIdx = -1;
+  for (int i = 0; i < _maxConnections; i++) {
+    if (_active[i] && _connections[i]->isClosed()) {
+      // if it's closed, clean up:
+      _connections[i]->reset();
+      _active[i] = false;
+      _statOpen--;
+    }
+
+    if (!_active[i]) {
+      uint8_t head = _queueHead.load(std::memory_order_relaxed);
+      if (head != _queueTail.load(std::memory_order_acquire)) {
+        PendingSocket &pending = _queue[head];
+        openConnection(i, pending.socket, &pending.addr, pending.addrLen);
+        _queueHead.store((head + 1) % HTTPS_WORKER_QUEUE_SIZE, std::memory_order_release);
+      }
+    }
+
+    if (!_active[i]) {
+      // Fetch a free index in the pointer array
+      freeConnectionIdx = i;
+    }
+  }
+
+  // Step 2: Collect the sockets of the open connections
+  // We create file descriptor sets to be able to use the select function
+  fd_set readfds;
+  fd_set writefds;
+  FD_ZERO(&readfds);
+  FD_ZERO(&writefds);
+  int maxSocket = -1;
+  bool hasWork = false;
+
+  for (int i = 0; i < _maxConnections; i++) {
+    if (_active[i]) {
+      int connectionSocket = _connections[i]->getSocket();
+      if (connectionSocket >= 0) {
+        FD_SET(connectionSocket, &readfds);
+        // Connections in the TLS handshake may need to wait until they can write
+        if (_connections[i]->isWaitingForWrite()) {
+          FD_SET(connectionSocket, &writefds);
+        }
+        maxSocket = std::max(maxSocket, connectionSocket);
+      }
+      hasWork |= _connections[i]->hasPendingData() || _connections[i]->needsProcessing();
+    }
+  }
+
+  // Threaded workers are woken up through this socket when the listener queues a new connection
+  if (_wakeupSocket >= 0) {
+    FD_SET(_wakeupSocket, &readfds);
+    maxSocket = std::max(maxSocket, _wakeupSocket);
+  }
+
+  // Checking for new connections makes only sense if there is space to store the connection
+  bool acceptConnections = (_listenSocket >= 0 && freeConnectionIdx > -1);
+  if (acceptConnections) {
+    FD_SET(_listenSocket, &readfds);
+    maxSocket = std::max(maxSocket, _listenSocket);
+  }
+
+  // Step 3: Check all sockets at once
+  if (maxSocket >= 0) {
+    // Don't wait if there is something to do anyway
+    timeval timeout;
+    timeout.tv_sec  = hasWork ? 0 : timeoutMs / 1000;
+    timeout.tv_usec = hasWork ? 0 : (timeoutMs % 1000) * 1000;
+
+    // As by 2017-12-14, it seems that FD_SETSIZE is defined as 0x40, but socket IDs now
+    // start at 0x1000, so we need to use maxSocket+1 here
+    if (select(maxSocket + 1, &readfds, &writefds, NULL, &timeout) < 0) {
+      FD_ZERO(&readfds);
+      FD_ZERO(&writefds);
+    }
+  } else if (timeoutMs > 0) {
+    delay(timeoutMs);
+  }
+
+  // Drop the wakeup signals. The queued sockets are taken over in the next pass
+  if (_wakeupSocket >= 0 && FD_ISSET(_wakeupSocket, &readfds)) {
+    byte signals[16];
+    while(recv(_wakeupSocket, signals, sizeof(signals), MSG_DONTWAIT) > 0);
+  }
+
+  // Step 4: Process the connections that are ready
+  uint8_t servicedConnections = 0;
+  for (int i = 0; i < _maxConnections; i++) {
+    HTTPConnection * connection = _connections[i];
+    if (_active[i] && !connection->isClosed()) {
+      int connectionSocket = connection->getSocket();
+      bool readable = connectionSocket >= 0 && FD_ISSET(connectionSocket, &readfds);
+      bool writable = connectionSocket >= 0 && FD_ISSET(connectionSocket, &writefds);
+      if (readable || writable || connection->hasPendingData() || connection->needsProcessing()) {
+        connection->setReadReady(readable);
+        connection->loop();
+        servicedConnections++;
+      }
+    }
+  }
+  _statServiced += servicedConnections;
+
+  // Step 5: Accept a new connection, if there is one
+  if (acceptConnections && FD_ISSET(_listenSocket, &readfds)) {
+    sockaddr addr;
+    socklen_t addrLen = sizeof(addr);
+    int socket = accept(_listenSocket, &addr, &addrLen);
+    if (socket >= 0) {
+      openConnection(freeConnectionIdx, socket, &addr, addrLen);
+    } else {
+      HTTPS_LOGE("Could not accept() new connection");
+    }
+  }
+
+  return servicedConnections;
+}
+
+/**
+ * Initializes the connection object of the given slot with an accepted socket
+ */
+void HTTPWorker::openConnection(int idx, int socket, const sockaddr * addr, socklen_t addrLen) {
+  HTTPConnection * connection = _connections[idx];
+  connection->setAcceptedSocket(socket, addr, addrLen);
+  connection->setPipelineDepth(_server->_pipelineDepth);
+  connection->setBufferPool(&_bufferPool);
+  connection->setErrorResponses(&_server->_errorResponses);
+  connection->setHandlerCache(&_server->_handlerCache);
+
+  // If initializing did not work, discard the new socket immediately
+  if (_server->initializeConnection(connection) < 0) {
+    connection->reset();
+    _statDropped++;
+  } else {
+    _active[idx] = true;
+    _statAccepted++;
+    _statOpen++;
+  }
+}
+
+/**
+ * Closes all connections of this worker. Blocks until every connection is shut down.
+ */
+void HTTPWorker::closeConnections() {
+  bool hasOpenConnections = true;
+  while(hasOpenConnections) {
+    hasOpenConnections = false;
+    for(int i = 0; i < _maxConnections; i++) {
+      if (_active[i]) {
+        _connections[i]->closeConnection();
+
+        // Check if closing succeeded. If not, we need to call the close function multiple times
+        // and wait for the client
+        if (_connections[i]->isClosed()) {
+          _connections[i]->reset();
+          _active[i] = false;
+          _statOpen--;
+        } else {
+          hasOpenConnections = true;
+        }
+      }
+    }
+    if (hasOpenConnections) {
+      delay(1);
+    }
+  }
+
+  // Sockets that have not been taken over yet can just be closed
+  uint8_t head = _queueHead.load(std::memory_order_relaxed);
+  while(head != _queueTail.load(std::memory_order_acquire)) {
+    close(_queue[head].socket);
+    _statDropped++;
+    head = (head + 1) % HTTPS_WORKER_QUEUE_SIZE;
+    _queueHead.store(head, std::memory_order_release);
+  }
+}
+
+/**
+ * Passes an accepted socket to the worker. Must only be called by a single thread (the listener).
+ *
+ * Returns false if the queue is full. In that case, the caller remains responsible for the socket.
+ */
+bool HTTPWorker::enqueueSocket(int socket, const sockaddr * addr, socklen_t addrLen) {
+  uint8_t tail = _queueTail.load(std::memory_order_relaxed);
+  uint8_t next = (tail + 1) % HTTPS_WORKER_QUEUE_SIZE;
+  if (next == _queueHead.load(std::memory_order_acquire)) {
+    return false;
+  }
+  _queue[tail].socket = socket;
+  _queue[tail].addrLen = std::min(addrLen, (socklen_t)sizeof(sockaddr));
+  memcpy(&_queue[tail].addr, addr, _queue[tail].addrLen);
+  _queueTail.store(next, std::memory_order_release);
+  wakeup();
+  return true;
+}
+
+/**
+ * Returns the number of open connections plus the number of sockets waiting in the queue
+ */
+uint8_t HTTPWorker::getLoad() {
+  uint8_t head = _queueHead.load(std::memory_order_acquire);
+  uint8_t tail = _queueTail.load(std::memory_order_acquire);
+  uint8_t queued = (tail + HTTPS_WORKER_QUEUE_SIZE - head) % HTTPS_WORKER_QUEUE_SIZE;
+  return _statOpen + queued;
+}
+
+uint8_t HTTPWorker::getMaxConnections() {
+  return _maxConnections;
+}
+
+uint8_t HTTPWorker::getId() {
+  return _id;
+}
+
+HTTPWorkerStats HTTPWorker::getStats() {
+  HTTPWorkerStats stats;
+  stats.acceptedConnections = _statAccepted;
+  stats.droppedConnections = _statDropped;
+  stats.loopPasses = _statLoopPasses;
+  stats.servicedConnections = _statServiced;
+  stats.openConnections = _statOpen;
+
+  // The connection objects themselves have been allocated in the constructor
+  stats.connectionAllocations = _maxConnections;
+  stats.responses = 0;
+  stats.socketWrites = 0;
+  stats.tlsRecords = 0;
+  for(uint8_t i = 0; i < _maxConnections; i++) {
+    stats.connectionAllocations += _connections[i]->getAllocationCount();
+    stats.responses += _connections[i]->getResponseCount();
+    stats.socketWrites += _connections[i]->getWriteCount();
+    stats.tlsRecords += _connections[i]->getRecordCount();
+  }
+  stats.responseBuffers = _bufferPool.getStats();
+  return stats;
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,130 @@
+#ifndef SRC_HTTPWORKER_HPP_
+#define SRC_HTTPWORKER_HPP_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <pthread.h>
+
+// Required for sockets
+#include "lwip/netdb.h"
+#undef read
+#include "lwip/sockets.h"
+
+#include "HTTPSServerConstants.hpp"
+#include "HTTPConnection.hpp"
+#include "HTTPBufferPool.hpp"
+
+namespace httpsserver {
+
+class HTTPServer;
+
+/**
+ * \brief Statistics of a single HTTPWorker, see HTTPServer::getWorkerStats()
+ */
+struct HTTPWorkerStats {
+  /** Number of connections that have been handed over to the worker */
+  uint32_t acceptedConnections;
+  /** Number of sockets that had to be dropped because the worker could not take them */
+  uint32_t droppedConnections;
+  /** Number of passes of the worker's loop */
+  uint32_t loopPasses;
+  /** Number of times a connection has been processed (sum over all passes) */
+  uint32_t servicedConnections;
+  /** Number of connections that are currently open */
+  uint8_t openConnections;
+  /**
+   * Number of heap allocations for connection objects and their storage (headers, TLS context).
+   * The connection objects are preallocated and reused, so this value stays constant once every
+   * slot has been used once.
+   */
+  uint32_t connectionAllocations;
+  /** Number of responses that have been sent */
+  uint32_t responses;
+  /** Number of writes to the sockets, for HTTPS the number of calls to SSL_write() */
+  uint32_t socketWrites;
+  /** Number of TLS records that have been sent, 0 for HTTP */
+  uint32_t tlsRecords;
+  /** Statistics of the worker's response buffer pool */
+  HTTPBufferPoolStats responseBuffers;
+};
+
+/**
+ * \brief Owns a set of connection slots and processes them
+ *
+ * By default, the HTTPServer uses a single worker that is run inline in HTTPServer::loop() and accepts
+ * new connections itself. In worker mode (see HTTPServer::setWorkerCount()), each worker runs its own
+ * loop in a separate thread, and the server's loop() only accepts new sockets and passes them to the
+ * workers through a lock-free queue.
+ *
+ * All connections of a worker are only ever touched by the thread that runs this worker.
+ */
+class HTTPWorker {
+public:
+  HTTPWorker(HTTPServer * server, uint8_t id, uint8_t maxConnections, int listenSocket = -1);
+  virtual ~HTTPWorker();
+
+  bool startThread();
+  void stopThread();
+  bool isThreaded();
+
+  uint8_t loop(unsigned long timeoutMs = 0);
+  void closeConnections();
+
+  bool enqueueSocket(int socket, const sockaddr * addr, socklen_t addrLen);
+  uint8_t getLoad();
+  uint8_t getMaxConnections();
+  uint8_t getId();
+  HTTPWorkerStats getStats();
+
+private:
+  // Entry of the hand-over queue between listener and worker
+  struct PendingSocket {
+    int socket;
+    sockaddr addr;
+    socklen_t addrLen;
+  };
+
+  static void * threadEntry(void * worker);
+  void openConnection(int idx, int socket, const sockaddr * addr, socklen_t addrLen);
+  bool openWakeupSocket();
+  void wakeup();
+
+  HTTPServer * _server;
+  const uint8_t _id;
+  const uint8_t _maxConnections;
+  // Server socket (inline worker only, -1 for threaded workers)
+  const int _listenSocket;
+
+  // The preallocated connection objects, one for each slot. They are reused for new sockets
+  HTTPConnection ** _connections;
+  // Marks the slots that hold an active connection
+  bool * _active;
+
+  // Response buffers for the connections of this worker
+  HTTPBufferPool _bufferPool;
+
+  // Single-producer single-consumer ring buffer of accepted sockets. The listener writes _queue[_queueTail]
+  // and advances _queueTail, the worker reads _queue[_queueHead] and advances _queueHead.
+  PendingSocket _queue[HTTPS_WORKER_QUEUE_SIZE];
+  std::atomic<uint8_t> _queueHead;
+  std::atomic<uint8_t> _queueTail;
+  // Loopback socket that ends the select() of a threaded worker when a socket is queued (-1 if not used)
+  int _wakeupSocket;
+
+  // Thread handling
+  pthread_t _thread;
+  bool _threadStarted;
+  std::atomic<bool> _threadRunning;
+
+  // Statistics, may be read from other threads
+  std::atomic<uint32_t> _statAccepted;
+  std::atomic<uint32_t> _statDropped;
+  std::atomic<uint32_t> _statLoopPasses;
+  std::atomic<uint32_t> _statServiced;
+  std::atomic<uint8_t> _statOpen;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_HTTPWORKER_HPP_ */
@@ -5,6 +5,7 @@ namespace httpsserver {
 ResolvedResource::ResolvedResource() {
   _matchingNode = NULL;
   _params = NULL;
+  _middlewareChain = NULL;
 }
 
 ResolvedResource::~ResolvedResource() {
@@ -37,4 +38,12 @@ void ResolvedResource::setParams(ResourceParameters * params) {
   _params = params;
 }
 
+const HTTPMiddlewareChain * ResolvedResource::getMiddlewareChain() {
+  return _middlewareChain;
+}
+
+void ResolvedResource::setMiddlewareChain(const HTTPMiddlewareChain * middlewareChain) {
+  _middlewareChain = middlewareChain;
+}
+
 } /* namespace httpsserver */
@@ -6,6 +6,8 @@
 
 namespace httpsserver {
 
+class HTTPMiddlewareChain;
+
 /**
  * \brief This class represents a resolved resource, meaning the result of mapping a string URL to an HTTPNode
  */
@@ -19,10 +21,14 @@ public:
   bool didMatch();
   ResourceParameters * getParams();
   void setParams(ResourceParameters * params);
+  const HTTPMiddlewareChain * getMiddlewareChain();
+  void setMiddlewareChain(const HTTPMiddlewareChain * middlewareChain);
 
 private:
   HTTPNode * _matchingNode;
   ResourceParameters * _params;
+  // The middleware that applies to the matching node
+  const HTTPMiddlewareChain * _middlewareChain;
 };
 
 } /* namespace httpsserver */
@@ -5,7 +5,21 @@ namespace httpsserver {
 ResourceNode::ResourceNode(const std::string &path, const std::string &method, const HTTPSCallbackFunction * callback, const std::string &tag):
   HTTPNode(path, HANDLER_CALLBACK, tag),
   _method(method),
-  _callback(callback) {
+  _methods(identifyMethod(method)),
+  _callback(callback),
+  _cacheTTL(0) {
+
+}
+
+/**
+ * Creates a node for several methods, which are given as combination of HTTPMethodId values
+ */
+ResourceNode::ResourceNode(const std::string &path, uint16_t methods, const HTTPSCallbackFunction * callback, const std::string &tag):
+  HTTPNode(path, HANDLER_CALLBACK, tag),
+  _method(methodMaskToString(methods)),
+  _methods(methods & METHOD_ANY),
+  _callback(callback),
+  _cacheTTL(0) {
 
 }
 
@@ -13,4 +27,35 @@ ResourceNode::~ResourceNode() {
   
 }
 
+/**
+ * Enables the handler cache of the server for this node.
+ *
+ * A complete response of the handler with status 200 is stored and sent again for ttlMillis
+ * milliseconds, without calling the handler. Middleware functions are still called for every
+ * request. Only use this for GET handlers whose output depends on nothing but the path and the
+ * query parameters added by addCacheKeyParameter(), not on request headers or on the client.
+ *
+ * A ttlMillis of 0 disables caching. The size of the cache is set with
+ * HTTPServer::setHandlerCacheCapacity().
+ */
+void ResourceNode::setHandlerCacheTTL(unsigned long ttlMillis) {
+  _cacheTTL = ttlMillis;
+}
+
+/**
+ * Adds a query parameter whose value selects a different response. Other query parameters are
+ * ignored, so requests that only differ in them get the same response from the cache.
+ */
+void ResourceNode::addCacheKeyParameter(std::string const &name) {
+  _cacheKeyParameters.push_back(name);
+}
+
+unsigned long ResourceNode::getHandlerCacheTTL() {
+  return _cacheTTL;
+}
+
+std::vector<std::string> const &ResourceNode::getCacheKeyParameters() {
+  return _cacheKeyParameters;
+}
+
 } /* namespace httpsserver */
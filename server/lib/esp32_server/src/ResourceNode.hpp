@@ -2,8 +2,13 @@
 #define SRC_RESOURCENODE_HPP_
 
 #include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <vector>
 
 #include "HTTPNode.hpp"
+#include "HTTPMethod.hpp"
 #include "HTTPSCallbackFunction.hpp"
 
 namespace httpsserver {
@@ -12,15 +17,35 @@ namespace httpsserver {
  * \brief This HTTPNode represents a route that maps to a regular HTTP request for a resource (static or dynamic)
  * 
  * It therefore contrasts to the WebsocketNode, which handles requests for Websockets.
+ *
+ * A node can be registered for several methods by combining HTTPMethodId values,
+ * like METHOD_GET | METHOD_POST. Nodes for GET also answer HEAD requests, unless
+ * another node has been registered for HEAD on the same path.
  */
 class ResourceNode : public HTTPNode {
 public:
   ResourceNode(const std::string &path, const std::string &method, const HTTPSCallbackFunction * callback, const std::string &tag = "");
+  ResourceNode(const std::string &path, uint16_t methods, const HTTPSCallbackFunction * callback, const std::string &tag = "");
   virtual ~ResourceNode();
 
+  /** Name of the method, or the names of all methods separated by "|" */
   const std::string _method;
+  /** The methods as combination of HTTPMethodId values, 0 if _method is no known method */
+  const uint16_t _methods;
   const HTTPSCallbackFunction * _callback;
   std::string getMethod() { return _method; }
+  uint16_t getMethods() { return _methods; }
+
+  void setHandlerCacheTTL(unsigned long ttlMillis);
+  void addCacheKeyParameter(std::string const &name);
+  unsigned long getHandlerCacheTTL();
+  std::vector<std::string> const &getCacheKeyParameters();
+
+private:
+  // Time in milliseconds that a response of the handler is replayed, 0 if it is not cached
+  unsigned long _cacheTTL;
+  // Query parameters that are part of the cache key, in addition to the path
+  std::vector<std::string> _cacheKeyParameters;
 };
 
 } /* namespace httpsserver */
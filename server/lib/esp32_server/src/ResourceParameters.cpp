@@ -3,7 +3,24 @@
 
 namespace httpsserver {
 
-ResourceParameters::ResourceParameters() {
+namespace {
+
+/** Marks an unused slot of the query index */
+const uint16_t EMPTY_SLOT = 0xFFFF;
+
+/** FNV-1a hash of a parameter name */
+uint32_t hashName(std::string const &name) {
+  uint32_t hash = 2166136261u;
+  for(size_t i = 0; i < name.size(); i++) {
+    hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+  }
+  return hash;
+}
+
+} /* namespace */
+
+ResourceParameters::ResourceParameters():
+  _queryParsed(true) {
 
 }
 
@@ -22,12 +39,7 @@ ResourceParameters::~ResourceParameters() {
  * @return true iff the parameter exists
  */
 bool ResourceParameters::isQueryParameterSet(std::string const &name) {
-  for(auto queryParam = _queryParams.begin(); queryParam != _queryParams.end(); ++queryParam) {
-    if ((*queryParam).first.compare(name)==0) {
-      return true;
-    }
-  }
-  return false;
+  return findQueryParameter(name) != EMPTY_SLOT;
 }
 
 /**
@@ -46,11 +58,10 @@ bool ResourceParameters::isQueryParameterSet(std::string const &name) {
  * @return true iff the parameter exists and the corresponding value has been written.
  */
 bool ResourceParameters::getQueryParameter(std::string const &name, std::string &value) {
-  for(auto queryParam = _queryParams.begin(); queryParam != _queryParams.end(); ++queryParam) {
-    if ((*queryParam).first.compare(name)==0) {
-      value=(*queryParam).second;
-      return true;
-    }
+  size_t idx = findQueryParameter(name);
+  if (idx != EMPTY_SLOT) {
+    value = _queryParams[idx].second;
+    return true;
   }
   return false;
 }
@@ -61,20 +72,18 @@ bool ResourceParameters::getQueryParameter(std::string const &name, std::string
  * Query parameters are key-value pairs that are appended to the URI after a question mark.
  * 
  * @param unique If true, return the number of unique keys (using the same key multiple times
- * is counted only once). False by default, as checking for uniqueness is not efficient.
+ * is counted only once). False by default.
  * @return Number of query parameters
  */
 size_t ResourceParameters::getQueryParameterCount(bool unique) {
+  parseQuery();
   if (!unique) {
     return _queryParams.size();
   }
+  // The index holds one entry per name
   size_t count = 0;
-  for(auto a = _queryParams.begin(); a != _queryParams.end(); ++a) {
-    bool exists = false;
-    for(auto b = _queryParams.begin(); !exists && b != a; ++b) {
-      exists = (*a).first.compare((*b).first)==0;
-    }
-    count += exists ? 0 : 1;
+  for(size_t slot = 0; slot < _queryIndex.size(); slot++) {
+    count += _queryIndex[slot] != EMPTY_SLOT ? 1 : 0;
   }
   return count;
 }
@@ -96,6 +105,7 @@ size_t ResourceParameters::getQueryParameterCount(bool unique) {
  * @return Iterator over std::pairs of std::strings that represent (key, value) pairs
  */
 std::vector<std::pair<std::string,std::string>>::iterator ResourceParameters::beginQueryParameters() {
+  parseQuery();
   return _queryParams.begin();
 }
 
@@ -103,14 +113,95 @@ std::vector<std::pair<std::string,std::string>>::iterator ResourceParameters::be
  * @brief Counterpart to beginQueryParameters() for iterating over query parameters
  */
 std::vector<std::pair<std::string,std::string>>::iterator ResourceParameters::endQueryParameters() {
+  parseQuery();
   return _queryParams.end();
 }
 
-void ResourceParameters::setQueryParameter(std::string const &name, std::string const &value) {
-  std::pair<std::string, std::string> param;
-  param.first = name;
-  param.second = value;
-  _queryParams.push_back(param);
+/**
+ * Sets the query string of the request, without the '?'. It is parsed when it is accessed.
+ */
+void ResourceParameters::setQueryString(const char * query, size_t length) {
+  _queryString.assign(query, length);
+  _queryParams.clear();
+  _queryIndex.clear();
+  _queryParsed = false;
+}
+
+/**
+ * Splits the query string into URL-decoded name-value pairs and indexes the names, if that has
+ * not been done yet.
+ */
+void ResourceParameters::parseQuery() {
+  if (_queryParsed) {
+    return;
+  }
+  _queryParsed = true;
+
+  size_t paramStart = 0;
+  while (paramStart <= _queryString.size()) {
+    // Parameters are separated by '&'
+    size_t paramEnd = _queryString.find('&', paramStart);
+    if (paramEnd == std::string::npos) {
+      paramEnd = _queryString.size();
+    }
+
+    // Use empty string if only name is set. /foo?bar&baz=1 will return "" for bar
+    if (paramEnd > paramStart && _queryParams.size() < EMPTY_SLOT) {
+      size_t nvSplitIdx = _queryString.find('=', paramStart);
+      if (nvSplitIdx > paramEnd) {
+        nvSplitIdx = paramEnd;
+      }
+      std::pair<std::string, std::string> param;
+      param.first = urlDecode(_queryString.substr(paramStart, nvSplitIdx - paramStart));
+      if (nvSplitIdx < paramEnd) {
+        param.second = urlDecode(_queryString.substr(nvSplitIdx + 1, paramEnd - nvSplitIdx - 1));
+      }
+      _queryParams.push_back(param);
+    }
+
+    paramStart = paramEnd + 1;
+  }
+  std::string().swap(_queryString);
+
+  if (_queryParams.empty()) {
+    return;
+  }
+
+  // Open addressing with a load factor of at most 1/2, so a lookup usually needs a single probe
+  size_t slots = 4;
+  while (slots < 2 * _queryParams.size()) {
+    slots *= 2;
+  }
+  _queryIndex.assign(slots, EMPTY_SLOT);
+  for(size_t idx = 0; idx < _queryParams.size(); idx++) {
+    size_t slot = hashName(_queryParams[idx].first) & (slots - 1);
+    while (_queryIndex[slot] != EMPTY_SLOT && _queryParams[_queryIndex[slot]].first != _queryParams[idx].first) {
+      slot = (slot + 1) & (slots - 1);
+    }
+    // Only the first occurence of a name is indexed
+    if (_queryIndex[slot] == EMPTY_SLOT) {
+      _queryIndex[slot] = idx;
+    }
+  }
+}
+
+/**
+ * Returns the index of the first query parameter with the name in _queryParams, or EMPTY_SLOT
+ */
+size_t ResourceParameters::findQueryParameter(std::string const &name) {
+  parseQuery();
+  if (_queryIndex.empty()) {
+    return EMPTY_SLOT;
+  }
+  size_t mask = _queryIndex.size() - 1;
+  size_t slot = hashName(name) & mask;
+  while (_queryIndex[slot] != EMPTY_SLOT) {
+    if (_queryParams[_queryIndex[slot]].first == name) {
+      return _queryIndex[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+  return EMPTY_SLOT;
 }
 
 /**
@@ -27,6 +27,10 @@ class ResourceResolver;
  * Query parameters are the key-value pairs after a question mark which can be added
  * to each request, either by specifying them manually or as result of submitting an
  * HTML form with a GET as method property.
+ *
+ * The query string is only split and decoded when a query parameter is accessed for
+ * the first time, so handlers that do not use it do not pay for parsing it. The names
+ * are then indexed by a small hash table for the lookups.
  */
 class ResourceParameters {
 public:
@@ -43,15 +47,25 @@ public:
 
 protected:
   friend class ResourceResolver;
-  void setQueryParameter(std::string const &name, std::string const &value);
+  friend class RouteTrie;
+  void setQueryString(const char * query, size_t length);
   void resetPathParameters();
   void setPathParameter(size_t idx, std::string const &val);
 
 private:
+  void parseQuery();
+  size_t findQueryParameter(std::string const &name);
+
   /** Parameters in the path of the URL, the actual values for asterisk placeholders */
   std::vector<std::string> _pathParams;
+  /** The raw query string (without '?'), until it has been parsed */
+  std::string _queryString;
+  /** Whether _queryString has been parsed into _queryParams */
+  bool _queryParsed;
   /** HTTP Query parameters, as key-value pairs */
   std::vector<std::pair<std::string, std::string>> _queryParams;
+  /** Hash table of indices into _queryParams, one for the first occurence of each name */
+  std::vector<uint16_t> _queryIndex;
 };
 
 } /* namespace httpsserver */
@@ -2,12 +2,59 @@
 
 namespace httpsserver {
 
+namespace {
+
+/**
+ * Checks whether a path is in the group of a path prefix: It is the prefix itself or a path
+ * below it, so "/api" contains "/api/items" but not "/apiary"
+ */
+bool isInGroup(std::string const &path, std::string const &pathPrefix) {
+  return path.compare(0, pathPrefix.size(), pathPrefix) == 0 && (path.size() == pathPrefix.size() ||
+    pathPrefix.empty() || pathPrefix[pathPrefix.size() - 1] == '/' || path[pathPrefix.size()] == '/');
+}
+
+/**
+ * Removes empty and "." segments from a decoded path and resolves ".." segments, so that a path
+ * like "//admin" or "/x/../admin" is assigned to the group of "/admin", like a file system would
+ * resolve it.
+ */
+std::string normalizePath(std::string const &path) {
+  std::string normalized;
+  size_t pos = 0;
+  while (pos <= path.size()) {
+    size_t end = path.find('/', pos);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    size_t length = end - pos;
+    if (length == 2 && path[pos] == '.' && path[pos + 1] == '.') {
+      size_t slash = normalized.rfind('/');
+      normalized.resize(slash == std::string::npos ? 0 : slash);
+    } else if (length > 0 && !(length == 1 && path[pos] == '.')) {
+      normalized += '/';
+      normalized.append(path, pos, length);
+    }
+    pos = end + 1;
+  }
+  if (normalized.empty() || path[path.size() - 1] == '/') {
+    normalized += '/';
+  }
+  return normalized;
+}
+
+} /* namespace */
+
 ResourceResolver::ResourceResolver() {
   _nodes = new std::vector<HTTPNode *>();
   _defaultNode = NULL;
+  _defaultNodeChains.chain = NULL;
 }
 
 ResourceResolver::~ResourceResolver() {
+  for(size_t i = 0; i < _nodeChains.size(); i++) {
+    deleteNodeChains(_nodeChains[i]);
+  }
+  deleteNodeChains(_defaultNodeChains);
   delete _nodes;
 }
 
@@ -16,16 +63,43 @@ ResourceResolver::~ResourceResolver() {
  */
 void ResourceResolver::registerNode(HTTPNode *node) {
   _nodes->push_back(node);
+  NodeChains chains;
+  chains.chain = NULL;
+  compileNodeChains(node, node->hasPathParameter() || node->isPathPrefix(), chains);
+  _nodeChains.push_back(chains);
+  _routes.insert(node, _nodes->size() - 1);
 }
 
 /**
- * This method can be used to deactivate a HTTPSNode that has been registered previously
+ * This method can be used to deactivate a HTTPSNode that has been registered previously. The
+ * middleware that has been added for the node is removed as well.
  */
 void ResourceResolver::unregisterNode(HTTPNode *node) {
-
+  for(size_t i = _nodes->size(); i > 0; i--) {
+    if ((*_nodes)[i - 1] == node) {
+      deleteNodeChains(_nodeChains[i - 1]);
+      _nodeChains.erase(_nodeChains.begin() + (i - 1));
+      _nodes->erase(_nodes->begin() + (i - 1));
+    }
+  }
+  removeRouteMiddleware(node, "", NULL);
+  _routes.clear();
+  for(size_t i = 0; i < _nodes->size(); i++) {
+    _routes.insert((*_nodes)[i], i);
+  }
 }
 
 void ResourceResolver::resolveNode(const std::string &method, const std::string &url, ResolvedResource &resolvedResource, HTTPNodeType nodeType) {
+  resolveNode(identifyMethod(method), method, url, resolvedResource, nodeType);
+}
+
+/**
+ * Finds the node for a request whose method has already been identified. The method name is only
+ * used if methodId is METHOD_UNKNOWN.
+ *
+ * HEAD requests are resolved to a node for GET if no node for HEAD matches.
+ */
+void ResourceResolver::resolveNode(HTTPMethodId methodId, const std::string &method, const std::string &url, ResolvedResource &resolvedResource, HTTPNodeType nodeType) {
   // Reset the resource
   resolvedResource.setMatchingNode(NULL);
   resolvedResource.setParams(NULL);
@@ -38,121 +112,32 @@ void ResourceResolver::resolveNode(const std::string &method, const std::string
   // Store this index to stop path parsing there
   size_t pathEnd = reqparamIdx != std::string::npos ? reqparamIdx : url.size();
 
-  // If no '?' is contained in url, 0:npos will return the string as it is
-  std::string resourceName = url.substr(0, reqparamIdx);
-
-  // Set request params in params object if a '?' exists
-  if (reqparamIdx != std::string::npos) {
-    do {
-      // Drop the '?' or '&'
-      reqparamIdx += 1;
-
-      // Parameters are separated by '&'
-      size_t nextparamIdx = url.find('&', reqparamIdx);
-
-      // Get the "name=value" string
-      std::string param = nextparamIdx == std::string::npos ?
-         url.substr(reqparamIdx) :
-         url.substr(reqparamIdx, nextparamIdx - reqparamIdx);
-
-      if (param.length() > 0) {
-        // Find the position where the string has to be split
-        size_t nvSplitIdx = param.find('=');
-
-        // Use empty string if only name is set. /foo?bar&baz=1 will return "" for bar
-        std::string name  = urlDecode(param.substr(0, nvSplitIdx));
-        std::string value = "";
-        if (nvSplitIdx != std::string::npos) {
-          value = urlDecode(param.substr(nvSplitIdx+1));
-        }
-
-        // Now we finally have name and value.
-        params->setQueryParameter(name, value);
-      }
-
-      // Update reqparamIdx
-      reqparamIdx = nextparamIdx;
-
-    } while(reqparamIdx != std::string::npos);
+  // Check whether a resource matches. If several nodes match, the one registered first is used
+  size_t nodeIdx;
+  HTTPNode * node = _routes.find(nodeType, methodId, method, url, pathEnd, &nodeIdx);
+  if (node == NULL && methodId == METHOD_HEAD) {
+    node = _routes.find(nodeType, METHOD_GET, method, url, pathEnd, &nodeIdx);
+  }
+  if (node != NULL) {
+    HTTPS_LOGD("Matching route: %s", node->_path.c_str());
+    RouteTrie::extractPathParameters(node, url, pathEnd, params);
+    resolvedResource.setMatchingNode(node);
+    resolvedResource.setMiddlewareChain(selectChain(_nodeChains[nodeIdx], url, pathEnd));
   }
-
-
-  // Check whether a resource matches
-
-  for(std::vector<HTTPNode*>::iterator itNode = _nodes->begin(); itNode != _nodes->end(); ++itNode) {
-    params->resetPathParameters();
-    HTTPNode *node = *itNode;
-    if (node->_nodeType==nodeType) {
-      if (
-        // For handler functions, check the method declared with the node
-        (node->_nodeType==HANDLER_CALLBACK && ((ResourceNode*)node)->_method == method) ||
-        // For websockets, the specification says that GET is the only choice
-        (node->_nodeType==WEBSOCKET && method=="GET")
-      ) {
-        HTTPS_LOGD("Testing route %s", node->_path.c_str());
-        bool match = true;
-        size_t paramCount = node->getPathParamCount();
-        // indices in input and pattern
-        size_t inputIdx = 0, pathIdx = 0;
-        HTTPS_LOGD("(INIT) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-          inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-
-        for (size_t paramIdx = 0; match && paramIdx < paramCount; paramIdx += 1) {
-          HTTPS_LOGD("(LOOP) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-            inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-          // Test static path before the parameter
-          size_t paramPos = node->getParamIdx(paramIdx);
-          size_t staticLength = paramPos - pathIdx;
-          match &= url.substr(inputIdx, staticLength) == node->_path.substr(pathIdx, staticLength);
-          inputIdx += staticLength;
-          pathIdx += staticLength;
-
-          // Extract parameter value
-          if (match) {
-            size_t paramEnd = url.find('/', inputIdx);
-            if (paramEnd == std::string::npos && inputIdx <= pathEnd) {
-              // Consume the remaining input (might be "" for the last param)
-              paramEnd = pathEnd;
-            }
-            if (paramEnd != std::string::npos) {
-              size_t paramLength = paramEnd - inputIdx;
-              params->setPathParameter(paramIdx, urlDecode(url.substr(inputIdx, paramLength)));
-              pathIdx += 1;
-              inputIdx += paramLength;
-            } else {
-              match = false;
-              HTTPS_LOGD("(LOOP) No match on param part");
-            }
-          } else {
-            HTTPS_LOGD("(LOOP) No match on static part");
-          }
-        }
-        HTTPS_LOGD("(STTC) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-          inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-        // Test static path after the parameter (up to pathEnd)
-        if (match) {
-          match = url.substr(inputIdx, pathEnd - inputIdx)==node->_path.substr(pathIdx);
-        }
-        HTTPS_LOGD("(END ) inputIdx: %d, pathIdx: %d, pathEnd: %d, path: %s, url: %s",
-          inputIdx, pathIdx, pathEnd, node->_path.c_str(), url.c_str());
-
-        if (match) {
-          resolvedResource.setMatchingNode(node);
-          HTTPS_LOGD("It's a match!");
-          break;
-        }
-      } // method check
-    } // node type check
-  } // resource node for loop
 
   // If the resource did not match, configure the default resource
   if (!resolvedResource.didMatch() && _defaultNode != NULL) {
     params->resetPathParameters();
     resolvedResource.setMatchingNode(_defaultNode);
+    resolvedResource.setMiddlewareChain(selectChain(_defaultNodeChains, url, pathEnd));
   }
 
-  // If resolving did work, set the params, otherwise delete them
+  // If resolving did work, set the params, otherwise delete them. The query is only parsed when
+  // the handler accesses it
   if (resolvedResource.didMatch()) {
+    if (pathEnd < url.size()) {
+      params->setQueryString(url.data() + pathEnd + 1, url.size() - pathEnd - 1);
+    }
     // The resolvedResource now takes care of memory management for the params
     resolvedResource.setParams(params);
   } else {
@@ -162,18 +147,175 @@ void ResourceResolver::resolveNode(const std::string &method, const std::string
 
 void ResourceResolver::addMiddleware(const HTTPSMiddlewareFunction * mwFunction) {
   _middleware.push_back(mwFunction);
+  compileMiddleware();
 }
 
 void ResourceResolver::removeMiddleware(const HTTPSMiddlewareFunction * mwFunction) {
   _middleware.erase(std::remove(_middleware.begin(), _middleware.end(), mwFunction), _middleware.end());
+  compileMiddleware();
+}
+
+/**
+ * Adds a middleware function that is called after the global and group middleware, but only for
+ * requests that are resolved to the node. This also works for the default node.
+ */
+void ResourceResolver::addMiddleware(HTTPNode * node, const HTTPSMiddlewareFunction * mwFunction) {
+  RouteMiddleware routeMiddleware;
+  routeMiddleware.node = node;
+  routeMiddleware.function = mwFunction;
+  _routeMiddleware.push_back(routeMiddleware);
+  compileMiddleware();
+}
+
+void ResourceResolver::removeMiddleware(HTTPNode * node, const HTTPSMiddlewareFunction * mwFunction) {
+  removeRouteMiddleware(node, "", mwFunction);
+  compileMiddleware();
+}
+
+/**
+ * Adds a middleware function for a group of paths: It is called after the global middleware for
+ * requests to pathPrefix or a path below it, like "/api" for "/api/items". This includes requests
+ * that are answered by nodes with path parameters or path prefixes, or by the default node. For
+ * those, the group is determined from the URL-decoded request path.
+ */
+void ResourceResolver::addMiddleware(std::string const &pathPrefix, const HTTPSMiddlewareFunction * mwFunction) {
+  RouteMiddleware routeMiddleware;
+  routeMiddleware.node = NULL;
+  routeMiddleware.pathPrefix = pathPrefix;
+  routeMiddleware.function = mwFunction;
+  _routeMiddleware.push_back(routeMiddleware);
+  compileMiddleware();
+}
+
+void ResourceResolver::removeMiddleware(std::string const &pathPrefix, const HTTPSMiddlewareFunction * mwFunction) {
+  removeRouteMiddleware(NULL, pathPrefix, mwFunction);
+  compileMiddleware();
 }
 
 const std::vector<HTTPSMiddlewareFunction*> ResourceResolver::getMiddleware() {
   return _middleware;
 }
 
+/**
+ * Returns the compiled middleware chain that the connections call for each request
+ */
+const HTTPMiddlewareChain &ResourceResolver::getMiddlewareChain() {
+  return _middlewareChain;
+}
+
 void ResourceResolver::setDefaultNode(HTTPNode * defaultNode) {
   _defaultNode = defaultNode;
+  compileNodeChains(_defaultNode, true, _defaultNodeChains);
+}
+
+/**
+ * Rebuilds the global chain and the chains of all nodes
+ */
+void ResourceResolver::compileMiddleware() {
+  _groupPrefixes.clear();
+  for(std::vector<RouteMiddleware>::iterator it = _routeMiddleware.begin(); it != _routeMiddleware.end(); ++it) {
+    if (it->node == NULL && std::find(_groupPrefixes.begin(), _groupPrefixes.end(), it->pathPrefix) == _groupPrefixes.end()) {
+      _groupPrefixes.push_back(it->pathPrefix);
+    }
+  }
+  _middlewareChain.compile(_middleware);
+  for(size_t i = 0; i < _nodes->size(); i++) {
+    HTTPNode * node = (*_nodes)[i];
+    compileNodeChains(node, node->hasPathParameter() || node->isPathPrefix(), _nodeChains[i]);
+  }
+  compileNodeChains(_defaultNode, true, _defaultNodeChains);
+}
+
+/**
+ * Updates the chains of a node. If pathDependent is set, the node may answer requests for other
+ * paths than its own, so there is a chain for each group.
+ */
+void ResourceResolver::compileNodeChains(HTTPNode * node, bool pathDependent, NodeChains &chains) {
+  size_t groupCount = (pathDependent && node != NULL ? _groupPrefixes.size() : 0);
+  for(size_t i = groupCount; i < chains.groupChains.size(); i++) {
+    delete chains.groupChains[i];
+  }
+  chains.groupChains.resize(groupCount, NULL);
+  for(size_t i = 0; i < groupCount; i++) {
+    chains.groupChains[i] = compileChain(node, &_groupPrefixes[i], chains.groupChains[i]);
+  }
+  chains.chain = compileChain(node, (pathDependent || node == NULL) ? NULL : &node->_path, chains.chain);
+}
+
+/**
+ * Updates a chain of a node, which may be NULL, and returns it. It contains the groups of path
+ * (none if path is NULL) and the middleware of the node. Returns NULL (and deletes the chain) if
+ * no group or node middleware applies, so the global chain is used.
+ */
+HTTPMiddlewareChain * ResourceResolver::compileChain(HTTPNode * node, std::string const * path, HTTPMiddlewareChain * chain) {
+  std::vector<const HTTPSMiddlewareFunction*> middleware;
+  if (node != NULL) {
+    for(std::vector<RouteMiddleware>::iterator it = _routeMiddleware.begin(); path != NULL && it != _routeMiddleware.end(); ++it) {
+      if (it->node == NULL && isInGroup(*path, it->pathPrefix)) {
+        middleware.push_back(it->function);
+      }
+    }
+    for(std::vector<RouteMiddleware>::iterator it = _routeMiddleware.begin(); it != _routeMiddleware.end(); ++it) {
+      if (it->node == node) {
+        middleware.push_back(it->function);
+      }
+    }
+  }
+  if (middleware.empty()) {
+    delete chain;
+    return NULL;
+  }
+  middleware.insert(middleware.begin(), _middleware.begin(), _middleware.end());
+  if (chain == NULL) {
+    chain = new HTTPMiddlewareChain();
+  }
+  chain->compile(middleware);
+  return chain;
+}
+
+/**
+ * Returns the chain of a node for a request. For nodes with a chain for each group, the longest
+ * group prefix that contains the request path is used. All groups that contain the request path
+ * contain that prefix as well, so its chain has the same groups as the request path.
+ */
+const HTTPMiddlewareChain * ResourceResolver::selectChain(NodeChains const &chains, std::string const &url, size_t pathEnd) {
+  HTTPMiddlewareChain * chain = chains.chain;
+  if (!chains.groupChains.empty()) {
+    // Compare the path like the node will interpret it, so "/%61dmin" is part of "/admin"
+    std::string path = normalizePath(urlDecode(url.substr(0, pathEnd)));
+    bool inGroup = false;
+    size_t groupLength = 0;
+    for(size_t i = 0; i < _groupPrefixes.size(); i++) {
+      if ((!inGroup || _groupPrefixes[i].size() > groupLength) && isInGroup(path, _groupPrefixes[i])) {
+        chain = chains.groupChains[i];
+        groupLength = _groupPrefixes[i].size();
+        inGroup = true;
+      }
+    }
+  }
+  return (chain != NULL ? chain : &_middlewareChain);
+}
+
+void ResourceResolver::deleteNodeChains(NodeChains &chains) {
+  delete chains.chain;
+  for(size_t i = 0; i < chains.groupChains.size(); i++) {
+    delete chains.groupChains[i];
+  }
+  chains.chain = NULL;
+  chains.groupChains.clear();
+}
+
+/**
+ * Removes the middleware of a node or of a path prefix. A mwFunction of NULL removes all of it.
+ */
+void ResourceResolver::removeRouteMiddleware(HTTPNode * node, std::string const &pathPrefix, const HTTPSMiddlewareFunction * mwFunction) {
+  for(size_t i = _routeMiddleware.size(); i > 0; i--) {
+    RouteMiddleware &routeMiddleware = _routeMiddleware[i - 1];
+    if (routeMiddleware.node == node && (node != NULL || routeMiddleware.pathPrefix == pathPrefix) &&
+        (mwFunction == NULL || routeMiddleware.function == mwFunction)) {
+      _routeMiddleware.erase(_routeMiddleware.begin() + (i - 1));
+    }
+  }
 }
 
 }
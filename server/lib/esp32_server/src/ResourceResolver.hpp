@@ -13,11 +13,24 @@
 #include "ResourceNode.hpp"
 #include "ResolvedResource.hpp"
 #include "HTTPMiddlewareFunction.hpp"
+#include "HTTPMiddlewareChain.hpp"
+#include "HTTPMethod.hpp"
+#include "RouteTrie.hpp"
 
 namespace httpsserver {
 
 /**
  * \brief This class is used internally to resolve a string URL to the corresponding HTTPNode
+ *
+ * Middleware can be added globally, for a group of paths below a path prefix, or
+ * for a single node. For each node, the middleware that applies to it is composed
+ * into a chain when the node or the middleware is added, in that order: global
+ * middleware, group middleware, node middleware. Nodes without group or node
+ * middleware share the global chain.
+ *
+ * Nodes with path parameters or path prefixes and the default node may answer
+ * requests inside and outside of a group. They get a chain for each group, which
+ * is selected by the request path when the request is resolved.
  */
 class ResourceResolver {
 public:
@@ -28,22 +41,64 @@ public:
   void unregisterNode(HTTPNode *node);
   void setDefaultNode(HTTPNode *node);
   void resolveNode(const std::string &method, const std::string &url, ResolvedResource &resolvedResource, HTTPNodeType nodeType);
+  void resolveNode(HTTPMethodId methodId, const std::string &method, const std::string &url, ResolvedResource &resolvedResource, HTTPNodeType nodeType);
 
   /** Add a middleware function to the end of the middleware function chain. See HTTPSMiddlewareFunction.hpp for details. */
   void addMiddleware(const HTTPSMiddlewareFunction * mwFunction);
   /** Remove a specific function from the middleware function chain. */
   void removeMiddleware(const HTTPSMiddlewareFunction * mwFunction);
+  /** Add a middleware function that is only called for requests to the node */
+  void addMiddleware(HTTPNode * node, const HTTPSMiddlewareFunction * mwFunction);
+  /** Remove a middleware function that has been added for the node */
+  void removeMiddleware(HTTPNode * node, const HTTPSMiddlewareFunction * mwFunction);
+  /** Add a middleware function that is only called for requests to pathPrefix or a path below it */
+  void addMiddleware(std::string const &pathPrefix, const HTTPSMiddlewareFunction * mwFunction);
+  /** Remove a middleware function that has been added for the path prefix */
+  void removeMiddleware(std::string const &pathPrefix, const HTTPSMiddlewareFunction * mwFunction);
   /** Get the current middleware chain with a resource function at the end */
   const std::vector<HTTPSMiddlewareFunction*> getMiddleware();
+  const HTTPMiddlewareChain &getMiddlewareChain();
 
 private:
+  // Middleware for a single node, or for the group of nodes below pathPrefix if node is NULL
+  struct RouteMiddleware {
+    HTTPNode * node;
+    std::string pathPrefix;
+    const HTTPSMiddlewareFunction * function;
+  };
+
+  // The middleware chains of a node. NULL stands for _middlewareChain. If the node only matches
+  // its own path, chain contains the groups of that path. Otherwise, chain is used outside of
+  // all groups, and groupChains[i] for requests whose longest matching group is _groupPrefixes[i].
+  struct NodeChains {
+    HTTPMiddlewareChain * chain;
+    std::vector<HTTPMiddlewareChain*> groupChains;
+  };
+
+  void compileMiddleware();
+  void compileNodeChains(HTTPNode * node, bool pathDependent, NodeChains &chains);
+  HTTPMiddlewareChain * compileChain(HTTPNode * node, std::string const * path, HTTPMiddlewareChain * chain);
+  const HTTPMiddlewareChain * selectChain(NodeChains const &chains, std::string const &url, size_t pathEnd);
+  static void deleteNodeChains(NodeChains &chains);
+  void removeRouteMiddleware(HTTPNode * node, std::string const &pathPrefix, const HTTPSMiddlewareFunction * mwFunction);
 
   // This vector holds all nodes (with callbacks) that are registered
   std::vector<HTTPNode*> * _nodes;
+  // The paths of _nodes, for looking up the node of a request
+  RouteTrie _routes;
   HTTPNode * _defaultNode;
 
   // Middleware functions, if any are registered. Will be called in order of the vector.
   std::vector<const HTTPSMiddlewareFunction*> _middleware;
+  // _middleware with the validation in front, rebuilt whenever _middleware changes
+  HTTPMiddlewareChain _middlewareChain;
+  // Group and node middleware, in the order it has been added
+  std::vector<RouteMiddleware> _routeMiddleware;
+  // The distinct path prefixes of the group middleware
+  std::vector<std::string> _groupPrefixes;
+  // Chains of the nodes in _nodes, at the same index
+  std::vector<NodeChains> _nodeChains;
+  NodeChains _defaultNodeChains;
 };
 
 } /* namespace httpsserver */
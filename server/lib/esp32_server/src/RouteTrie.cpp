@@ -0,0 +1,235 @@
+#include "RouteTrie.hpp"
+
+namespace httpsserver {
+
+namespace {
+
+const size_t NO_INDEX = (size_t)-1;
+
+/**
+ * Returns the end of the segment that starts at pos, which is the next slash or pathEnd
+ */
+size_t segmentEnd(const char * path, size_t pos, size_t pathEnd) {
+  const char * slash = (const char *)memchr(path + pos, '/', pathEnd - pos);
+  return slash != NULL ? slash - path : pathEnd;
+}
+
+} /* namespace */
+
+RouteTrie::RouteTrie() {
+
+}
+
+RouteTrie::~RouteTrie() {
+  clear();
+}
+
+/**
+ * Adds a node. Nodes have to be inserted in the order of their index, nodes with the same path as
+ * an earlier one are ignored.
+ */
+void RouteTrie::insert(HTTPNode * node, size_t index) {
+  if (node->_nodeType != HANDLER_CALLBACK) {
+    // For websockets, the specification says that GET is the only choice
+    insert(findRoot(node->_nodeType, METHOD_GET, ""), node, index);
+    return;
+  }
+  ResourceNode * resourceNode = (ResourceNode*)node;
+  if (resourceNode->_methods == METHOD_UNKNOWN) {
+    insert(findRoot(HANDLER_CALLBACK, METHOD_UNKNOWN, resourceNode->_method), node, index);
+  }
+  for(uint16_t method = 1; method <= METHOD_ANY; method <<= 1) {
+    if ((resourceNode->_methods & method) != 0) {
+      insert(findRoot(HANDLER_CALLBACK, (HTTPMethodId)method, ""), node, index);
+    }
+  }
+}
+
+/**
+ * Adds a node to the tree of one method
+ */
+void RouteTrie::insert(TrieNode * current, HTTPNode * node, size_t index) {
+  // A prefix node with a trailing slash needs another segment, instead of an empty last segment
+  const std::string &path = node->_path;
+  bool prefixSlash = node->isPathPrefix() && !path.empty() && path[path.size() - 1] == '/';
+  size_t pathEnd = (prefixSlash ? path.size() - 1 : path.size());
+
+  current->minIndex = std::min(current->minIndex, index);
+  size_t pos = 0;
+  while (pos <= pathEnd) {
+    size_t end = segmentEnd(path.data(), pos, pathEnd);
+    // Like in HTTPNode, only "/*" followed by a slash or the end is a parameter
+    if (pos > 0 && end - pos == 1 && path[pos] == '*') {
+      if (current->wildcard == NULL) {
+        current->wildcard = createNode("*");
+      }
+      current = current->wildcard;
+    } else {
+      TrieNode * child = findChild(current, path.data() + pos, end - pos);
+      if (child == NULL) {
+        child = createNode(path.substr(pos, end - pos));
+        std::vector<TrieNode*>::iterator it = current->children.begin();
+        while (it != current->children.end() && (*it)->segment < child->segment) {
+          ++it;
+        }
+        current->children.insert(it, child);
+      }
+      current = child;
+    }
+    current->minIndex = std::min(current->minIndex, index);
+    pos = end + 1;
+  }
+
+  Route &route = (prefixSlash ? current->prefixSlash : (node->isPathPrefix() ? current->prefix : current->exact));
+  if (route.node == NULL) {
+    route.node = node;
+    route.index = index;
+  }
+}
+
+/**
+ * Removes all nodes
+ */
+void RouteTrie::clear() {
+  for(std::vector<Root>::iterator root = _roots.begin(); root != _roots.end(); ++root) {
+    deleteNode(root->node);
+  }
+  _roots.clear();
+}
+
+/**
+ * Returns the node with the smallest index that matches the path of the url, which ends at
+ * pathEnd (the start of the query), or NULL. If index is given, the index of the node is written
+ * to it.
+ */
+HTTPNode * RouteTrie::find(HTTPNodeType nodeType, HTTPMethodId methodId, std::string const &method,
+    std::string const &url, size_t pathEnd, size_t * index) {
+  for(std::vector<Root>::iterator root = _roots.begin(); root != _roots.end(); ++root) {
+    if (root->nodeType == nodeType && root->methodId == methodId &&
+        (methodId != METHOD_UNKNOWN || root->method == method)) {
+      Route best = {NULL, NO_INDEX};
+      search(root->node, url.data(), 0, pathEnd, best);
+      if (index != NULL) {
+        *index = best.index;
+      }
+      return best.node;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Sets the path parameters of a node that matches the url. The values are URL-decoded.
+ */
+void RouteTrie::extractPathParameters(HTTPNode * node, std::string const &url, size_t pathEnd, ResourceParameters * params) {
+  if (!node->hasPathParameter()) {
+    return;
+  }
+  const std::string &path = node->_path;
+  size_t paramIdx = 0;
+  size_t nodePos = 0;
+  size_t urlPos = 0;
+  while (nodePos <= path.size() && urlPos <= pathEnd) {
+    size_t nodeEnd = segmentEnd(path.data(), nodePos, path.size());
+    size_t urlEnd = segmentEnd(url.data(), urlPos, pathEnd);
+    if (nodePos > 0 && nodeEnd - nodePos == 1 && path[nodePos] == '*') {
+      params->setPathParameter(paramIdx++, urlDecode(url.substr(urlPos, urlEnd - urlPos)));
+    }
+    nodePos = nodeEnd + 1;
+    urlPos = urlEnd + 1;
+  }
+}
+
+/**
+ * Returns the tree for a node type and method, which is created if it does not exist
+ */
+RouteTrie::TrieNode * RouteTrie::findRoot(HTTPNodeType nodeType, HTTPMethodId methodId, std::string const &method) {
+  for(std::vector<Root>::iterator root = _roots.begin(); root != _roots.end(); ++root) {
+    if (root->nodeType == nodeType && root->methodId == methodId && root->method == method) {
+      return root->node;
+    }
+  }
+  Root root;
+  root.nodeType = nodeType;
+  root.methodId = methodId;
+  root.method = method;
+  root.node = createNode("");
+  _roots.push_back(root);
+  return root.node;
+}
+
+RouteTrie::TrieNode * RouteTrie::createNode(std::string const &segment) {
+  TrieNode * node = new TrieNode();
+  node->segment = segment;
+  node->wildcard = NULL;
+  node->exact.node = NULL;
+  node->exact.index = NO_INDEX;
+  node->prefix = node->exact;
+  node->prefixSlash = node->exact;
+  node->minIndex = NO_INDEX;
+  return node;
+}
+
+void RouteTrie::deleteNode(TrieNode * node) {
+  for(std::vector<TrieNode*>::iterator child = node->children.begin(); child != node->children.end(); ++child) {
+    deleteNode(*child);
+  }
+  if (node->wildcard != NULL) {
+    deleteNode(node->wildcard);
+  }
+  delete node;
+}
+
+/**
+ * Finds the literal child for a segment by binary search
+ */
+RouteTrie::TrieNode * RouteTrie::findChild(const TrieNode * node, const char * segment, size_t length) {
+  size_t low = 0;
+  size_t high = node->children.size();
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    int cmp = node->children[mid]->segment.compare(0, std::string::npos, segment, length);
+    if (cmp == 0) {
+      return node->children[mid];
+    } else if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Searches the subtree of node for the path from pos on. pos is the start of the next segment, or
+ * pathEnd + 1 if the whole path has been consumed.
+ */
+void RouteTrie::search(const TrieNode * node, const char * path, size_t pos, size_t pathEnd, Route &best) {
+  if (node->minIndex >= best.index) {
+    return;
+  }
+  if (pos > pathEnd) {
+    consider(node->exact, best);
+    consider(node->prefix, best);
+    return;
+  }
+  consider(node->prefix, best);
+  consider(node->prefixSlash, best);
+
+  size_t end = segmentEnd(path, pos, pathEnd);
+  const TrieNode * child = findChild(node, path + pos, end - pos);
+  if (child != NULL) {
+    search(child, path, end + 1, pathEnd, best);
+  }
+  if (node->wildcard != NULL) {
+    search(node->wildcard, path, end + 1, pathEnd, best);
+  }
+}
+
+void RouteTrie::consider(Route const &route, Route &best) {
+  if (route.node != NULL && route.index < best.index) {
+    best = route;
+  }
+}
+
+} /* namespace httpsserver */
@@ -0,0 +1,91 @@
+#ifndef SRC_ROUTETRIE_HPP_
+#define SRC_ROUTETRIE_HPP_
+
+#include <string>
+// Arduino declares it's own min max, incompatible with the stl...
+#undef min
+#undef max
+#include <vector>
+
+#include "HTTPSServerConstants.hpp"
+#include "HTTPNode.hpp"
+#include "HTTPMethod.hpp"
+#include "ResourceNode.hpp"
+#include "ResourceParameters.hpp"
+#include "util.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief Finds the node for a URL path without testing each registered node, used by ResourceResolver
+ *
+ * The paths of the nodes are split into segments at each slash and stored in a
+ * tree, with one tree for each node type and method. Nodes for several methods are
+ * stored in the tree of each of them. Each edge of a tree stands
+ * for one segment. A "*" segment (a path parameter) is a wildcard edge that
+ * matches any segment, the others match by comparison. So a lookup only follows
+ * the segments of the URL and does not depend on the number of nodes.
+ *
+ * If several nodes match a URL, the one that has been registered first wins, as
+ * with the linear search that the resolver used before. Every tree node knows the
+ * smallest registration index below it, so branches that cannot contain an
+ * earlier node are skipped.
+ */
+class RouteTrie {
+public:
+  RouteTrie();
+  virtual ~RouteTrie();
+
+  void insert(HTTPNode * node, size_t index);
+  void clear();
+  HTTPNode * find(HTTPNodeType nodeType, HTTPMethodId methodId, std::string const &method, std::string const &url,
+    size_t pathEnd, size_t * index = NULL);
+
+  static void extractPathParameters(HTTPNode * node, std::string const &url, size_t pathEnd, ResourceParameters * params);
+
+private:
+  // A node of the application together with its registration index
+  struct Route {
+    HTTPNode * node;
+    size_t index;
+  };
+
+  struct TrieNode {
+    // Segment of the edge that leads to this node
+    std::string segment;
+    // Children for literal segments, sorted by segment
+    std::vector<TrieNode*> children;
+    // Child for the "*" segment, or NULL
+    TrieNode * wildcard;
+    // Node whose path ends here
+    Route exact;
+    // Prefix node (see HTTPNode::isPathPrefix()) whose path ends here. It also matches longer paths
+    Route prefix;
+    // Prefix node whose path ends here with a slash. It only matches longer paths
+    Route prefixSlash;
+    // Smallest registration index in this subtree
+    size_t minIndex;
+  };
+
+  // Tree for one node type and method. The name is only used for METHOD_UNKNOWN
+  struct Root {
+    HTTPNodeType nodeType;
+    HTTPMethodId methodId;
+    std::string method;
+    TrieNode * node;
+  };
+
+  TrieNode * findRoot(HTTPNodeType nodeType, HTTPMethodId methodId, std::string const &method);
+  void insert(TrieNode * root, HTTPNode * node, size_t index);
+  static TrieNode * createNode(std::string const &segment);
+  static void deleteNode(TrieNode * node);
+  static TrieNode * findChild(const TrieNode * node, const char * segment, size_t length);
+  static void search(const TrieNode * node, const char * path, size_t pos, size_t pathEnd, Route &best);
+  static void consider(Route const &route, Route &best);
+
+  std::vector<Root> _roots;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_ROUTETRIE_HPP_ */
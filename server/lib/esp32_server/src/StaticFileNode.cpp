@@ -0,0 +1,358 @@
+#include "StaticFileNode.hpp"
+
+namespace httpsserver {
+
+namespace {
+
+struct ContentTypeMapping {
+  const char * extension;
+  const char * contentType;
+};
+
+// Types of the files that are usually served by a device. Everything else is sent as
+// application/octet-stream
+const ContentTypeMapping CONTENT_TYPES[] = {
+  {"html",  "text/html"},
+  {"htm",   "text/html"},
+  {"css",   "text/css"},
+  {"js",    "application/javascript"},
+  {"mjs",   "application/javascript"},
+  {"json",  "application/json"},
+  {"map",   "application/json"},
+  {"txt",   "text/plain"},
+  {"csv",   "text/csv"},
+  {"xml",   "application/xml"},
+  {"svg",   "image/svg+xml"},
+  {"png",   "image/png"},
+  {"jpg",   "image/jpeg"},
+  {"jpeg",  "image/jpeg"},
+  {"gif",   "image/gif"},
+  {"webp",  "image/webp"},
+  {"ico",   "image/x-icon"},
+  {"woff",  "font/woff"},
+  {"woff2", "font/woff2"},
+  {"ttf",   "font/ttf"},
+  {"wasm",  "application/wasm"},
+  {"pdf",   "application/pdf"},
+  {"zip",   "application/zip"},
+  {"bin",   "application/octet-stream"},
+};
+
+struct ContentEncoding {
+  const char * name;
+  const char * extension;
+};
+
+// Encodings of precompressed sidecar files, in the order of preference
+const ContentEncoding CONTENT_ENCODINGS[] = {
+  {"br",   ".br"},
+  {"gzip", ".gz"},
+};
+
+const char * DAY_NAMES[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+const char * MONTH_NAMES[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+/**
+ * Formats a timestamp as HTTP date, like "Sun, 06 Nov 1994 08:49:37 GMT"
+ */
+std::string formatHTTPDate(time_t time) {
+  struct tm tm;
+  gmtime_r(&time, &tm);
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+    DAY_NAMES[tm.tm_wday], tm.tm_mday, MONTH_NAMES[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+  return std::string(buffer);
+}
+
+/**
+ * Parses an HTTP date in the format of formatHTTPDate(). Returns false for other formats.
+ */
+bool parseHTTPDate(std::string const &date, time_t * time) {
+  char month[4];
+  int day, year, hour, minute, second;
+  if (sscanf(date.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &day, month, &year, &hour, &minute, &second) != 6) {
+    return false;
+  }
+  int mon = -1;
+  for(int i = 0; i < 12; i++) {
+    if (strcmp(month, MONTH_NAMES[i]) == 0) {
+      mon = i + 1;
+    }
+  }
+  if (mon < 0 || year < 1970) {
+    return false;
+  }
+  // Days since 1970-01-01 of the proleptic Gregorian calendar, as timegm() is not available
+  // everywhere
+  int y = year - (mon <= 2 ? 1 : 0);
+  int era = y / 400;
+  int yearOfEra = y - era * 400;
+  int dayOfYear = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = (long)era * 146097 + dayOfEra - 719468;
+  *time = (time_t)days * 86400 + hour * 3600 + minute * 60 + second;
+  return true;
+}
+
+/**
+ * Returns true if the list of entity tags of an If-None-Match header contains the tag. The
+ * comparison is weak, so W/ prefixes are ignored.
+ */
+bool etagListContains(std::string const &list, std::string const &etag) {
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    size_t start = list.find_first_not_of(" \t", pos);
+    size_t last = list.find_last_not_of(" \t", end - 1);
+    if (start != std::string::npos && start < end && last >= start) {
+      if (list.compare(start, 2, "W/") == 0) {
+        start += 2;
+      }
+      if (list.compare(start, last + 1 - start, "*") == 0 || list.compare(start, last + 1 - start, etag) == 0) {
+        return true;
+      }
+    }
+    pos = end + 1;
+  }
+  return false;
+}
+
+/**
+ * Returns true if an Accept-Encoding header allows the content coding, either by name or by
+ * "*". Codings with q=0 are not acceptable.
+ */
+bool acceptsEncoding(std::string const &list, const char * coding) {
+  bool wildcard = false;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    size_t start = list.find_first_not_of(" \t", pos);
+    if (start != std::string::npos && start < end) {
+      size_t nameEnd = list.find_first_of(" \t;", start);
+      if (nameEnd == std::string::npos || nameEnd > end) {
+        nameEnd = end;
+      }
+      bool acceptable = true;
+      size_t q = list.find("q=", nameEnd);
+      if (q != std::string::npos && q < end) {
+        acceptable = strtod(list.c_str() + q + 2, NULL) > 0;
+      }
+      std::string name = list.substr(start, nameEnd - start);
+      if (strcasecmp(name.c_str(), coding) == 0) {
+        return acceptable;
+      }
+      if (name == "*") {
+        wildcard = acceptable;
+      }
+    }
+    pos = end + 1;
+  }
+  return wildcard;
+}
+
+} /* namespace */
+
+StaticFileNode::StaticFileNode(const std::string &path, fs::FS &fs, const std::string &directory, const std::string &tag):
+  ResourceNode(path, "GET", &StaticFileNode::handleRequest, tag),
+  _fs(fs),
+  _directory(directory.size() > 1 && directory[directory.size() - 1] == '/' ? directory.substr(0, directory.size() - 1) : directory),
+  _indexFile("index.html"),
+  _precompressed(true) {
+  _pathPrefix = true;
+}
+
+StaticFileNode::~StaticFileNode() {
+
+}
+
+/**
+ * Sets the file that is served for paths ending with a slash, "index.html" by default
+ */
+void StaticFileNode::setIndexFile(const std::string &indexFile) {
+  _indexFile = indexFile;
+}
+
+/**
+ * Sets a Cache-Control header that is sent with every file, like "max-age=3600". By default,
+ * none is sent and clients revalidate according to their own heuristics.
+ */
+void StaticFileNode::setCacheControl(const std::string &cacheControl) {
+  _cacheControl = cacheControl;
+}
+
+/**
+ * Enables or disables serving precompressed sidecar files (enabled by default).
+ *
+ * If enabled, a request for "/app.js" is answered with "app.js.br" or "app.js.gz" from the same
+ * directory if the file exists and the client accepts the encoding. The response carries the
+ * Content-Type of the original file and the matching Content-Encoding. All file responses of
+ * the node contain "Vary: Accept-Encoding", so caches keep the variants apart.
+ */
+void StaticFileNode::setPrecompressed(bool precompressed) {
+  _precompressed = precompressed;
+}
+
+/**
+ * Returns the Content-Type for the extension of the path
+ */
+const char * StaticFileNode::getContentType(const std::string &path) {
+  size_t dot = path.find_last_of("./");
+  if (dot != std::string::npos && path[dot] == '.') {
+    const char * extension = path.c_str() + dot + 1;
+    for(size_t i = 0; i < sizeof(CONTENT_TYPES) / sizeof(CONTENT_TYPES[0]); i++) {
+      if (strcasecmp(extension, CONTENT_TYPES[i].extension) == 0) {
+        return CONTENT_TYPES[i].contentType;
+      }
+    }
+  }
+  return "application/octet-stream";
+}
+
+/**
+ * Callback of the ResourceNode, which forwards to the node that has been resolved
+ */
+void StaticFileNode::handleRequest(HTTPRequest * req, HTTPResponse * res) {
+  ((StaticFileNode *)req->getResolvedNode())->serve(req, res);
+}
+
+void StaticFileNode::serve(HTTPRequest * req, HTTPResponse * res) {
+  // The part of the path below the node's path is mapped to the directory
+  std::string url = req->getRequestString();
+  size_t pathEnd = url.find('?');
+  if (pathEnd == std::string::npos) {
+    pathEnd = url.size();
+  }
+  size_t prefixLength = std::min(_path.size(), pathEnd);
+  if (prefixLength == pathEnd && (pathEnd == 0 || url[pathEnd - 1] != '/')) {
+    // The path of the node is the top directory, which is redirected like the directories below it
+    sendDirectoryRedirect(res, url, pathEnd);
+    return;
+  }
+  std::string relativePath = urlDecode(url.substr(prefixLength, pathEnd - prefixLength));
+  if (relativePath.empty() || relativePath[0] != '/') {
+    relativePath.insert(0, 1, '/');
+  }
+
+  // Do not leave the directory
+  if (relativePath.find('\0') != std::string::npos || (relativePath + "/").find("/../") != std::string::npos) {
+    HTTPS_LOGW("Rejected static file path %s", relativePath.c_str());
+    sendNotFound(res);
+    return;
+  }
+
+  std::string filePath = _directory + relativePath;
+  if (filePath[filePath.size() - 1] == '/') {
+    filePath += _indexFile;
+  }
+
+  // Prefer a compressed sidecar of the file, if the client accepts its encoding
+  fs::File file;
+  const char * contentEncoding = NULL;
+  if (_precompressed) {
+    std::string acceptEncoding = req->getHeader("Accept-Encoding");
+    for(size_t i = 0; i < sizeof(CONTENT_ENCODINGS) / sizeof(CONTENT_ENCODINGS[0]) && !acceptEncoding.empty(); i++) {
+      if (acceptsEncoding(acceptEncoding, CONTENT_ENCODINGS[i].name)) {
+        file = _fs.open((filePath + CONTENT_ENCODINGS[i].extension).c_str(), "r");
+        if (file && !file.isDirectory()) {
+          contentEncoding = CONTENT_ENCODINGS[i].name;
+          break;
+        }
+        file = fs::File();
+      }
+    }
+  }
+  if (!file) {
+    file = _fs.open(filePath.c_str(), "r");
+  }
+  if (!file) {
+    sendNotFound(res);
+    return;
+  }
+  if (file.isDirectory()) {
+    file.close();
+    sendDirectoryRedirect(res, url, pathEnd);
+    return;
+  }
+
+  res->setHeader("Content-Type", getContentType(filePath));
+  if (contentEncoding != NULL) {
+    res->setHeader("Content-Encoding", contentEncoding);
+  }
+  if (_precompressed) {
+    res->setHeader("Vary", "Accept-Encoding");
+  }
+  if (!_cacheControl.empty()) {
+    res->setHeader("Cache-Control", _cacheControl);
+  }
+
+  // Validators are only available if the file system stores modification times
+  size_t size = file.size();
+  time_t lastWrite = file.getLastWrite();
+  if (lastWrite > 0) {
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)size, (unsigned long)lastWrite);
+    res->setHeader("ETag", etag);
+    res->setHeader("Last-Modified", formatHTTPDate(lastWrite));
+    if (isNotModified(req, etag, lastWrite)) {
+      file.close();
+      res->setStatusCode(304);
+      res->setStatusText("Not Modified");
+      return;
+    }
+  }
+
+  // Stream the file in blocks. If it cannot be read completely, the response is shorter than
+  // its Content-Length, and the connection is closed afterwards. For HEAD, nothing is read.
+  res->beginStream(size);
+  byte buffer[HTTPS_STATIC_FILE_CHUNK_SIZE];
+  size_t remaining = (res->isBodyOmitted() ? 0 : size);
+  while (remaining > 0) {
+    size_t length = file.read(buffer, std::min(remaining, sizeof(buffer)));
+    if (length == 0) {
+      HTTPS_LOGE("Could not read %s", filePath.c_str());
+      break;
+    }
+    res->write(buffer, length);
+    remaining -= length;
+  }
+  file.close();
+}
+
+/**
+ * Evaluates the conditional headers of the request. If-None-Match takes precedence over
+ * If-Modified-Since, as required by RFC 9110.
+ */
+bool StaticFileNode::isNotModified(HTTPRequest * req, std::string const &etag, time_t lastWrite) {
+  HTTPHeaders * headers = req->getHTTPHeaders();
+  if (headers->isSet("If-None-Match")) {
+    return etagListContains(headers->getValue("If-None-Match"), etag);
+  }
+  time_t since;
+  return headers->isSet("If-Modified-Since") && parseHTTPDate(headers->getValue("If-Modified-Since"), &since) &&
+    lastWrite <= since;
+}
+
+void StaticFileNode::sendNotFound(HTTPResponse * res) {
+  res->setStatusCode(404);
+  res->setStatusText("Not Found");
+  res->setHeader("Content-Type", "text/plain");
+  res->print("404 Not Found");
+}
+
+/**
+ * Redirects a directory to the path with a slash, so relative links in the index file work.
+ * The query string is kept.
+ */
+void StaticFileNode::sendDirectoryRedirect(HTTPResponse * res, std::string const &url, size_t pathEnd) {
+  res->setStatusCode(301);
+  res->setStatusText("Moved Permanently");
+  res->setHeader("Location", url.substr(0, pathEnd) + "/" + url.substr(pathEnd));
+}
+
+} /* namespace httpsserver */
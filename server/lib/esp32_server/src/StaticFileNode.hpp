@@ -0,0 +1,72 @@
+#ifndef SRC_STATICFILENODE_HPP_
+#define SRC_STATICFILENODE_HPP_
+
+#include <Arduino.h>
+#include <FS.h>
+#include <time.h>
+
+#include <string>
+
+#include "HTTPSServerConstants.hpp"
+#include "ResourceNode.hpp"
+
+namespace httpsserver {
+
+/**
+ * \brief A ResourceNode that serves the files of a directory on a file system like SPIFFS or LittleFS
+ *
+ * The node handles GET requests for its path and every path below it. The rest of the
+ * path is mapped to the directory, so a node for "/static" with the directory "/www" serves
+ * "/static/css/main.css" from "/www/css/main.css". Paths that end with a slash are
+ * mapped to the index file (index.html by default). Requests for directories without
+ * the slash, including "/static" itself, are redirected to the path with the slash.
+ *
+ * Files are streamed in blocks of HTTPS_STATIC_FILE_CHUNK_SIZE bytes with a
+ * Content-Length, so they are never loaded into memory completely and keep-alive
+ * connections stay reusable. The Content-Type is derived from the file extension.
+ *
+ * If the file system provides modification times, the responses carry an ETag and
+ * a Last-Modified header, and conditional requests (If-None-Match,
+ * If-Modified-Since) are answered with 304 Not Modified.
+ *
+ * Precompressed sidecar files (file.br, file.gz) are served instead of the file
+ * if the client accepts their encoding, see setPrecompressed().
+ *
+ * The path of the node must not contain path parameters.
+ */
+class StaticFileNode : public ResourceNode {
+public:
+  StaticFileNode(const std::string &path, fs::FS &fs, const std::string &directory, const std::string &tag = "");
+  virtual ~StaticFileNode();
+
+  void setIndexFile(const std::string &indexFile);
+  void setCacheControl(const std::string &cacheControl);
+  void setPrecompressed(bool precompressed);
+
+  static const char * getContentType(const std::string &path);
+
+protected:
+  static void handleRequest(HTTPRequest * req, HTTPResponse * res);
+
+  void serve(HTTPRequest * req, HTTPResponse * res);
+  bool isNotModified(HTTPRequest * req, std::string const &etag, time_t lastWrite);
+  void sendNotFound(HTTPResponse * res);
+  void sendDirectoryRedirect(HTTPResponse * res, std::string const &url, size_t pathEnd);
+
+  // File system and directory that the files are served from
+  fs::FS &_fs;
+  const std::string _directory;
+
+  // File that is served for paths that end with a slash
+  std::string _indexFile;
+
+  // Value of the Cache-Control header, not sent if empty
+  std::string _cacheControl;
+
+  // Whether .br and .gz sidecar files are served to clients that accept them
+  bool _precompressed;
+};
+
+} /* namespace httpsserver */
+
+#endif /* SRC_STATICFILENODE_HPP_ */
@@ -174,15 +174,12 @@ void WebsocketHandler::close(uint16_t status, std::string message) {
   frame.opCode = OPCODE_CLOSE;
   frame.mask   = 0;
   frame.len    = message.length() + 2;
-  int rc = _con->writeBuffer((uint8_t *)&frame, sizeof(frame));
-
-  if (rc > 0) {
-    rc = _con->writeBuffer((byte *) &status, 2);
-  }
-
-  if (rc > 0) {
-    _con->writeBuffer((byte *) message.data(), message.length());
-  }
+  ConnectionBufferSegment segments[3] = {
+    {(const byte *)&frame, sizeof(frame)},
+    {(const byte *)&status, 2},
+    {(const byte *)message.data(), message.length()}
+  };
+  _con->writeBuffers(segments, 3);
 } // Websocket::close
 
 /**
@@ -201,16 +198,20 @@ void WebsocketHandler::send(std::string data, uint8_t sendType) {
   frame.rsv3   = 0;
   frame.opCode = sendType==SEND_TYPE_TEXT?OPCODE_TEXT:OPCODE_BINARY;
   frame.mask   = 0;
+  // Frame header, extended length and payload are sent with a single write
+  uint16_t net_len = htons((uint16_t)data.length());  // Convert to network byte order from host byte order
+  ConnectionBufferSegment segments[3] = {
+    {(const byte *)&frame, sizeof(frame)},
+    {(const byte *)&net_len, 0},
+    {(const byte *)data.data(), data.length()}
+  };
   if (data.length() < 126) {
     frame.len = data.length();
-    _con->writeBuffer((uint8_t *)&frame, sizeof(frame));
   } else {
     frame.len = 126;
-    _con->writeBuffer((uint8_t *)&frame, sizeof(frame));
-    uint16_t net_len = htons((uint16_t)data.length());
-    _con->writeBuffer((uint8_t *)&net_len, sizeof(uint16_t));  // Convert to network byte order from host byte order
+    segments[1].length = sizeof(uint16_t);
   }
-  _con->writeBuffer((uint8_t*)data.data(), data.length());
+  _con->writeBuffers(segments, 3);
   HTTPS_LOGD("<< Websocket.send()");
 } // Websocket::send
 
@@ -231,16 +232,20 @@ void WebsocketHandler::send(uint8_t* data, uint16_t length, uint8_t sendType) {
   frame.rsv3   = 0;
   frame.opCode = sendType==SEND_TYPE_TEXT?OPCODE_TEXT:OPCODE_BINARY;
   frame.mask   = 0;
+  // Frame header, extended length and payload are sent with a single write
+  uint16_t net_len = htons(length);  // Convert to network byte order from host byte order
+  ConnectionBufferSegment segments[3] = {
+    {(const byte *)&frame, sizeof(frame)},
+    {(const byte *)&net_len, 0},
+    {(const byte *)data, length}
+  };
   if (length < 126) {
     frame.len = length;
-    _con->writeBuffer((uint8_t *)&frame, sizeof(frame));
   } else {
     frame.len = 126;
-    _con->writeBuffer((uint8_t *)&frame, sizeof(frame));
-    uint16_t net_len = htons(length);
-    _con->writeBuffer((uint8_t *)&net_len, sizeof(uint16_t));  // Convert to network byte order from host byte order
+    segments[1].length = sizeof(uint16_t);
   }
-  _con->writeBuffer(data, length);
+  _con->writeBuffers(segments, 3);
   HTTPS_LOGD("<< Websocket.send()");
 }  // Websocket::send
 
@@ -70,7 +70,7 @@ std::string urlDecode(std::string input) {
   // Now replace percent-escapes
   idxFound = input.find('%');
   while (idxFound != std::string::npos) {
-    if (idxFound <= input.length() + 3) {
+    if (idxFound + 2 < input.length()) {
       char hex[2] = { input[idxFound+1], input[idxFound+2] };
       byte val = 0;
       for(int n = 0; n < sizeof(hex); n++) {
@@ -14,6 +14,7 @@
 
 // Required for ResourceNodes definition
 #include <ResourceNode.hpp>
+#include <StaticFileNode.hpp>
 
 // mDNS Manager
 #include <ESPmDNS.h>
@@ -178,6 +179,17 @@ void shutdown() {
     logMessage(LOG, "Server shutdown complete.");
 }
 
+// Web assets from /www on SPIFFS (see generate_assets.bash) below /ui. They are optional, so the
+// node is only registered if they have been uploaded.
+static void registerAssets(ResourceResolver * server) {
+    if (!SPIFFS.exists("/www/index.html")) {
+        logMessage(LOG, "No web assets found in /www.");
+        return;
+    }
+    server->registerNode(new StaticFileNode("/ui", SPIFFS, "/www"));
+    logMessage(LOG, "Serving web assets at /ui/.");
+}
+
 void startServer(int port, bool securityFlag) {
     // Initialize SPIFFS (file system)
     if (!SPIFFS.begin(true)) {
@@ -210,6 +222,7 @@ void startServer(int port, bool securityFlag) {
         ResourceNode * node404  = new ResourceNode("", "POST", &handle404);
 
         serverHTTPS->registerNode(nodeRoot);
+        registerAssets(serverHTTPS);
         serverHTTPS->setDefaultNode(node404);
 
         // Start the server
@@ -225,6 +238,7 @@ void startServer(int port, bool securityFlag) {
         ResourceNode * node404  = new ResourceNode("", "POST", &handle404);
 
         serverHTTP->registerNode(nodeRoot);
+        registerAssets(serverHTTP);
         serverHTTP->setDefaultNode(node404);
 
         // Start the server